@@ -40,22 +40,34 @@
 #include "ocs_os.h"
 #include "ocs_array.h"
 
+/* Number of empty polls a consumer makes before sleeping */
+#define OCS_CBUF_SPIN_COUNT		256
+
+typedef struct {
+	uint32_t seq;			/*<< slot sequence, gives ownership to producer or consumer */
+	void *elem;			/*<< entry */
+} ocs_cbuf_slot_t;
+
 struct ocs_cbuf_s {
 	ocs_os_handle_t os;		/*<< OS handle */
-	uint32_t entry_count;		/*<< entry count */
-	void **array;			/*<< pointer to array of cbuf pointers */
+	uint32_t entry_count;		/*<< entry count, power of 2 */
+	uint32_t mask;			/*<< entry_count - 1 */
+	ocs_cbuf_slot_t *array;		/*<< array of cbuf slots */
+	ocs_sem_t cbuf_csem;		/*<< wakes sleeping consumers */
+	uint8_t rsvd0[OCS_CACHE_LINE_SIZE];
 	uint32_t pidx;			/*<< producer index */
+	uint8_t rsvd1[OCS_CACHE_LINE_SIZE - sizeof(uint32_t)];
 	uint32_t cidx;			/*<< consumer index */
-	ocs_lock_t cbuf_plock;		/*<< idx lock */
-	ocs_lock_t cbuf_clock;		/*<< idx lock */
-	ocs_sem_t cbuf_psem;		/*<< cbuf producer counting semaphore */
-	ocs_sem_t cbuf_csem;		/*<< cbuf consumer counting semaphore */
+	uint8_t rsvd2[OCS_CACHE_LINE_SIZE - sizeof(uint32_t)];
+	uint32_t waiters;		/*<< consumers sleeping on cbuf_csem */
+	uint8_t rsvd3[OCS_CACHE_LINE_SIZE - sizeof(uint32_t)];
 };
 
 /**
  * @brief Initialize a circular buffer queue
  *
- * A circular buffer with producer/consumer API is allocated
+ * A circular buffer with producer/consumer API is allocated. The entry count
+ * is rounded up to a power of 2.
  *
  * @param os OS handle
  * @param entry_count count of entries
@@ -66,6 +78,7 @@ ocs_cbuf_t*
 ocs_cbuf_alloc(ocs_os_handle_t os, uint32_t entry_count)
 {
 	ocs_cbuf_t *cbuf;
+	uint32_t i;
 
 	cbuf = ocs_malloc(os, sizeof(*cbuf), OCS_M_NOWAIT | OCS_M_ZERO);
 	if (cbuf == NULL) {
@@ -73,21 +86,23 @@ ocs_cbuf_alloc(ocs_os_handle_t os, uint32_t entry_count)
 	}
 
 	cbuf->os = os;
-	cbuf->entry_count = entry_count;
+	cbuf->entry_count = B32_NEXT_POWER_OF_2(entry_count);
+	cbuf->mask = cbuf->entry_count - 1;
 	cbuf->pidx = 0;
 	cbuf->cidx = 0;
 
-	ocs_lock_init(NULL, &cbuf->cbuf_clock, "cbuf_c:%p", cbuf);
-	ocs_lock_init(NULL, &cbuf->cbuf_plock, "cbuf_p:%p", cbuf);
 	ocs_sem_init(&cbuf->cbuf_csem, 0, "cbuf:%p", cbuf);
-	ocs_sem_init(&cbuf->cbuf_psem, cbuf->entry_count, "cbuf:%p", cbuf);
 
-	cbuf->array = ocs_malloc(os, entry_count * sizeof(*cbuf->array), OCS_M_NOWAIT | OCS_M_ZERO);
+	cbuf->array = ocs_malloc(os, cbuf->entry_count * sizeof(*cbuf->array), OCS_M_NOWAIT | OCS_M_ZERO);
 	if (cbuf->array == NULL) {
 		ocs_cbuf_free(cbuf);
 		return NULL;
 	}
 
+	for (i = 0; i < cbuf->entry_count; i++) {
+		cbuf->array[i].seq = i;
+	}
+
 	return cbuf;
 }
 
@@ -107,12 +122,160 @@ ocs_cbuf_free(ocs_cbuf_t *cbuf)
 		if (cbuf->array != NULL) {
 			ocs_free(cbuf->os, cbuf->array, sizeof(*cbuf->array) * cbuf->entry_count);
 		}
-		ocs_lock_free(&cbuf->cbuf_clock);
-		ocs_lock_free(&cbuf->cbuf_plock);
 		ocs_free(cbuf->os, cbuf, sizeof(*cbuf));
 	}
 }
 
+/**
+ * @brief Claim the next slot and write an entry
+ *
+ * @param cbuf pointer to circular buffer
+ * @param elem pointer to entry
+ *
+ * @return returns 0 for success, or -1 if the buffer is full.
+ */
+static inline int32_t
+ocs_cbuf_enqueue(ocs_cbuf_t *cbuf, void *elem)
+{
+	ocs_cbuf_slot_t *slot;
+	uint32_t pos = __atomic_load_n(&cbuf->pidx, __ATOMIC_RELAXED);
+	int32_t diff;
+
+	for (;;) {
+		slot = &cbuf->array[pos & cbuf->mask];
+		diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&cbuf->pidx, &pos, pos + 1, TRUE,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			pos = __atomic_load_n(&cbuf->pidx, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->elem = elem;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * @brief Claim the next filled slot and read its entry
+ *
+ * @param cbuf pointer to circular buffer
+ *
+ * @return pointer to entry, or NULL if the buffer is empty.
+ */
+static inline void *
+ocs_cbuf_dequeue(ocs_cbuf_t *cbuf)
+{
+	ocs_cbuf_slot_t *slot;
+	uint32_t pos = __atomic_load_n(&cbuf->cidx, __ATOMIC_RELAXED);
+	int32_t diff;
+	void *elem;
+
+	for (;;) {
+		slot = &cbuf->array[pos & cbuf->mask];
+		diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&cbuf->cidx, &pos, pos + 1, TRUE,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return NULL;
+		} else {
+			pos = __atomic_load_n(&cbuf->cidx, __ATOMIC_RELAXED);
+		}
+	}
+
+	elem = slot->elem;
+	__atomic_store_n(&slot->seq, pos + cbuf->mask + 1, __ATOMIC_RELEASE);
+	return elem;
+}
+
+/**
+ * @brief Drop one sleeping consumer registration, if any is left
+ *
+ * @param cbuf pointer to circular buffer
+ *
+ * @return TRUE if a registration was dropped.
+ */
+static inline uint8_t
+ocs_cbuf_waiter_dec(ocs_cbuf_t *cbuf)
+{
+	uint32_t w = __atomic_load_n(&cbuf->waiters, __ATOMIC_RELAXED);
+
+	while (w > 0) {
+		if (__atomic_compare_exchange_n(&cbuf->waiters, &w, w - 1, TRUE,
+						__ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * @brief Get a burst of buffers
+ *
+ * Read up to count buffers. If the circular buffer is empty, poll it briefly,
+ * then sleep until a producer posts a buffer or the timeout expires. A stale
+ * wakeup may return 0 before the timeout.
+ *
+ * @param cbuf pointer to circular buffer
+ * @param elems array receiving the buffer pointers
+ * @param count size of the elems array
+ * @param timeout_usec timeout in microseconds (0 - try once, < 0 wait forever)
+ *
+ * @return number of buffers read
+ */
+uint32_t
+ocs_cbuf_get_burst(ocs_cbuf_t *cbuf, void **elems, uint32_t count, int32_t timeout_usec)
+{
+	uint32_t n = 0;
+	uint32_t spin;
+	uint8_t woken = FALSE;
+
+	for (spin = 0; spin < OCS_CBUF_SPIN_COUNT; spin++) {
+		while (n < count && (elems[n] = ocs_cbuf_dequeue(cbuf)) != NULL) {
+			n++;
+		}
+		if (n > 0 || timeout_usec == 0) {
+			return n;
+		}
+	}
+
+	/* idle: register as a sleeper, then re-check before blocking */
+	__atomic_add_fetch(&cbuf->waiters, 1, __ATOMIC_RELAXED);
+	/* pairs with the fence in ocs_cbuf_put() */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if ((elems[0] = ocs_cbuf_dequeue(cbuf)) == NULL) {
+		woken = (ocs_sem_p(&cbuf->cbuf_csem, timeout_usec) == 0);
+		elems[0] = ocs_cbuf_dequeue(cbuf);
+	}
+
+	/*
+	 * A post means the producer already dropped one registration for us;
+	 * dropping another would strand a different sleeper. Otherwise drop
+	 * ours. If a producer raced us to it, its post stays pending and wakes
+	 * the next sleeper, so no registered sleeper is left without a post.
+	 */
+	if (!woken) {
+		ocs_cbuf_waiter_dec(cbuf);
+	}
+
+	if (elems[0] == NULL) {
+		return 0;
+	}
+	for (n = 1; n < count && (elems[n] = ocs_cbuf_dequeue(cbuf)) != NULL; n++) {
+		;
+	}
+	return n;
+}
+
 /**
  * @brief Get pointer to buffer
  *
@@ -128,14 +291,8 @@ ocs_cbuf_get(ocs_cbuf_t *cbuf, int32_t timeout_usec)
 {
 	void *ret = NULL;
 
-	if (likely(ocs_sem_p(&cbuf->cbuf_csem, timeout_usec) == 0)) {
-		ocs_lock(&cbuf->cbuf_clock);
-			ret = cbuf->array[cbuf->cidx];
-			if (unlikely(++cbuf->cidx >= cbuf->entry_count)) {
-				cbuf->cidx = 0;
-			}
-		ocs_unlock(&cbuf->cbuf_clock);
-		ocs_sem_v(&cbuf->cbuf_psem);
+	if (ocs_cbuf_get_burst(cbuf, &ret, 1, timeout_usec) == 0) {
+		return NULL;
 	}
 	return ret;
 }
@@ -143,7 +300,8 @@ ocs_cbuf_get(ocs_cbuf_t *cbuf, int32_t timeout_usec)
 /**
  * @brief write a buffer
  *
- * The buffer is written to the circular buffer.
+ * The buffer is written to the circular buffer. If the circular buffer is
+ * full, the caller backs off until a consumer frees a slot.
  *
  * @param cbuf pointer to circular buffer
  * @param elem pointer to entry
@@ -153,20 +311,20 @@ ocs_cbuf_get(ocs_cbuf_t *cbuf, int32_t timeout_usec)
 int32_t
 ocs_cbuf_put(ocs_cbuf_t *cbuf, void *elem)
 {
-	int32_t rc = 0;
+	uint32_t spin = 0;
 
-	if (likely(ocs_sem_p(&cbuf->cbuf_psem, -1) == 0)) {
-		ocs_lock(&cbuf->cbuf_plock);
-			cbuf->array[cbuf->pidx] = elem;
-			if (unlikely(++cbuf->pidx >= cbuf->entry_count)) {
-				cbuf->pidx = 0;
-			}
-		ocs_unlock(&cbuf->cbuf_plock);
+	while (unlikely(ocs_cbuf_enqueue(cbuf, elem) != 0)) {
+		if (++spin > OCS_CBUF_SPIN_COUNT) {
+			ocs_udelay(1);
+		}
+	}
+
+	/* pairs with the fence in ocs_cbuf_get_burst() */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&cbuf->waiters, __ATOMIC_RELAXED) && ocs_cbuf_waiter_dec(cbuf)) {
 		ocs_sem_v(&cbuf->cbuf_csem);
-	} else {
-		rc = -1;
 	}
-	return rc;
+	return 0;
 }
 
 /**
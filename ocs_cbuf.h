@@ -51,6 +51,7 @@ typedef struct ocs_cbuf_s ocs_cbuf_t;
 extern ocs_cbuf_t *ocs_cbuf_alloc(ocs_os_handle_t os, uint32_t entry_count);
 extern void ocs_cbuf_free(ocs_cbuf_t *cbuf);
 extern void *ocs_cbuf_get(ocs_cbuf_t *cbuf, int32_t timeout_usec);
+extern uint32_t ocs_cbuf_get_burst(ocs_cbuf_t *cbuf, void **elems, uint32_t count, int32_t timeout_usec);
 extern int32_t ocs_cbuf_put(ocs_cbuf_t *cbuf, void *elem);
 extern int32_t ocs_cbuf_prime(ocs_cbuf_t *cbuf, ocs_array_t *array);
 
@@ -488,8 +488,10 @@ ocs_ddump_hal(ocs_textbuf_t *textbuf, ocs_hal_t *hal, uint32_t flags, uint32_t q
 
 	ocs_lock(&hal->io_lock);
 		ocs_ddump_section(textbuf, "io_inuse", ocs->instance_index);
-		ocs_list_foreach(&hal->io_inuse, io) {
-			ocs_ddump_hal_io(textbuf, io);
+		for (i = 0; hal->io_inuse && i < hal->config.n_io; i++) {
+			if (ocs_bitmap_test(hal->io_inuse, i)) {
+				ocs_ddump_hal_io(textbuf, &hal->io[i]);
+			}
 		}
 		ocs_ddump_endsection(textbuf, "io_inuse", ocs->instance_index);
 
@@ -506,6 +508,11 @@ ocs_ddump_hal(ocs_textbuf_t *textbuf, ocs_hal_t *hal, uint32_t flags, uint32_t q
 			}
 			cnt++;
 		}
+		if (hal->io_cache) {
+			for (i = 0; i < OCS_HAL_IO_CACHE_MAX_CPUS; i++) {
+				cnt += hal->io_cache[i].count;
+			}
+		}
 		ocs_ddump_endsection(textbuf, "io_free", ocs->instance_index);
 		ocs_ddump_value(textbuf, "ios_free", "%d", cnt);
 
@@ -566,6 +573,8 @@ hal_queue_ddump(ocs_textbuf_t *textbuf, ocs_hal_t *hal)
 		ocs_ddump_section(textbuf, "eq", eq->instance);
 		ocs_ddump_value(textbuf, "queue-id", "%d", eq->queue->id);
 		OCS_STAT(ocs_ddump_value(textbuf, "use_count", "%d", eq->use_count));
+		ocs_ddump_value(textbuf, "poll_idle_enter", "%" PRIu64, eq->poll_idle_enter);
+		ocs_ddump_value(textbuf, "poll_timed", "%" PRIu64, eq->poll_timed);
 		ocs_list_foreach(&eq->cq_list, cq) {
 			ocs_ddump_section(textbuf, "cq", cq->instance);
 			ocs_ddump_value(textbuf, "queue-id", "%d", cq->queue->id);
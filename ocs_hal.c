@@ -88,6 +88,8 @@ static ocs_hal_rtn_e ocs_hal_init_io(ocs_hal_t *);
 static int32_t ocs_hal_flush(ocs_hal_t *);
 static int32_t ocs_hal_command_cancel(ocs_hal_t *);
 static int32_t ocs_hal_io_cancel(ocs_hal_t *);
+static void ocs_hal_io_cache_flush(ocs_hal_t *);
+static uint32_t ocs_hal_io_inuse_count(ocs_hal_t *);
 static void ocs_hal_io_quarantine(ocs_hal_t *hal, hal_wq_t *wq, ocs_hal_io_t *io);
 static void ocs_hal_io_restore_sgl(ocs_hal_t *, ocs_hal_io_t *);
 static int32_t ocs_hal_io_ini_sge(ocs_hal_t *, ocs_hal_io_t *, ocs_dma_t *, uint32_t, ocs_dma_t *);
@@ -412,6 +414,13 @@ ocs_hal_setup(ocs_hal_t *hal, ocs_os_handle_t os, sli4_port_type_e port_type)
 	/* by default, enable initiator-only auto-ABTS emulation */
 	hal->config.i_only_aab = TRUE;
 
+	/*
+	 * Each EQ, and the CQs on it, is polled by a single poller thread.
+	 * WQs are written from several threads unless configured otherwise.
+	 */
+	hal->config.q_single_consumer = TRUE;
+	hal->config.wq_single_producer = FALSE;
+
 	/* Setup run-time workarounds */
 	ocs_hal_workaround_setup(hal);
 
@@ -548,15 +557,9 @@ ocs_hal_init(ocs_hal_t *hal)
 			ocs_log_debug(hal->os, "%s: removed %d items from io_wait_free list\n", __func__, rem_count);
 		}
 	}
-	rem_count=0;
-	if (ocs_list_valid(&hal->io_inuse)) {
-		while ((!ocs_list_empty(&hal->io_inuse))) {
-			rem_count++;
-			ocs_list_remove_head(&hal->io_inuse);
-		}
-		if (rem_count > 0) {
-			ocs_log_debug(hal->os, "%s: removed %d items from io_inuse list\n", __func__, rem_count);
-		}
+	rem_count = ocs_hal_io_inuse_count(hal);
+	if (rem_count > 0) {
+		ocs_log_debug(hal->os, "%s: %d items still marked in io_inuse map\n", __func__, rem_count);
 	}
 	rem_count=0;
 	if (ocs_list_valid(&hal->io_free)) {
@@ -573,7 +576,6 @@ ocs_hal_init(ocs_hal_t *hal)
 			ocs_list_remove_head(&hal->io_port_owned);
 		}
 	}
-	ocs_list_init(&hal->io_inuse, ocs_hal_io_t, link);
 	ocs_list_init(&hal->io_free, ocs_hal_io_t, link);
 	ocs_list_init(&hal->io_port_owned, ocs_hal_io_t, link);
 	ocs_list_init(&hal->io_wait_free, ocs_hal_io_t, link);
@@ -1204,6 +1206,13 @@ ocs_hal_teardown(ocs_hal_t *hal)
 		hal->wqe_buffs = NULL;
 	}
 
+	ocs_bitmap_free(hal->io_inuse);
+	hal->io_inuse = NULL;
+	if (hal->io_cache) {
+		ocs_free(hal->os, hal->io_cache, OCS_HAL_IO_CACHE_MAX_CPUS * sizeof(ocs_hal_io_cache_t));
+		hal->io_cache = NULL;
+	}
+
 	ocs_dma_free(hal->os, &hal->xfer_rdy);
 	ocs_dma_free(hal->os, &hal->dump_sges);
 	ocs_dma_free(hal->os, &hal->loop_map);
@@ -1350,11 +1359,12 @@ ocs_hal_reset(ocs_hal_t *hal, ocs_hal_reset_e reset)
 			while (!ocs_list_empty(&hal->io_timed_wqe)) {
 				ocs_list_remove_head(&hal->io_timed_wqe);
 			}
-			/* Don't clean up the io_inuse list, the backend will do that when it finishes the IO */
+			/* Don't clean up the io_inuse map, the backend will do that when it finishes the IO */
 
 			while (!ocs_list_empty(&hal->io_free)) {
 				ocs_list_remove_head(&hal->io_free);
 			}
+			ocs_hal_io_cache_flush(hal);
 			while (!ocs_list_empty(&hal->io_wait_free)) {
 				ocs_list_remove_head(&hal->io_wait_free);
 			}
@@ -1950,6 +1960,12 @@ ocs_hal_set(ocs_hal_t *hal, ocs_hal_property_e prop, uint32_t value)
 	case OCS_HAL_BOUNCE:
 		hal->config.bounce = value;
 		break;
+	case OCS_HAL_Q_SINGLE_CONSUMER:
+		hal->config.q_single_consumer = value;
+		break;
+	case OCS_HAL_WQ_SINGLE_PRODUCER:
+		hal->config.wq_single_producer = value;
+		break;
 	default:
 		ocs_log_test(hal->os, "%s: unsupported property %#x\n", __func__, prop);
 		rc = OCS_HAL_RTN_ERROR;
@@ -3275,6 +3291,130 @@ ocs_hal_init_free_io(ocs_hal_io_t *io)
 	io->tgt_wqe_timeout = 0;
 }
 
+/**
+ * @ingroup io
+ * @brief Mark a HAL IO object as in use.
+ *
+ * @par Description
+ * The in-use map is indexed by the XRI offset of the IO, which is also its
+ * index in hal->io[].
+ *
+ * @param hal Hardware context.
+ * @param io Pointer to the HAL IO object.
+ */
+static inline void
+ocs_hal_io_set_inuse(ocs_hal_t *hal, ocs_hal_io_t *io)
+{
+	ocs_bitmap_set_atomic(hal->io_inuse, io - hal->io);
+}
+
+/**
+ * @ingroup io
+ * @brief Clear the in-use mark of a HAL IO object.
+ *
+ * @param hal Hardware context.
+ * @param io Pointer to the HAL IO object.
+ */
+static inline void
+ocs_hal_io_clear_inuse(ocs_hal_t *hal, ocs_hal_io_t *io)
+{
+	ocs_bitmap_clear_atomic(hal->io_inuse, io - hal->io);
+}
+
+/**
+ * @ingroup io
+ * @brief Count the HAL IO objects in use.
+ *
+ * @par Description
+ * Walks the in-use map, so the IO fast path updates no shared counter.
+ *
+ * @param hal Hardware context.
+ *
+ * @return Returns the number of IOs in use.
+ */
+static uint32_t
+ocs_hal_io_inuse_count(ocs_hal_t *hal)
+{
+	if (hal->io_inuse == NULL) {
+		return 0;
+	}
+
+	return ocs_bitmap_count(hal->io_inuse, hal->config.n_io);
+}
+
+/**
+ * @ingroup io
+ * @brief Return the free IO cache of the calling lcore.
+ *
+ * @par Description
+ * Each lcore is served by a single thread, so its cache needs no locking.
+ * Returns NULL for threads without an lcore id, or when the caches are
+ * disabled; those callers use hal->io_free under hal->io_lock.
+ *
+ * @param hal Hardware context.
+ *
+ * @return Returns a pointer to the cache, or NULL.
+ */
+static inline ocs_hal_io_cache_t *
+ocs_hal_io_cache_get(ocs_hal_t *hal)
+{
+	int32_t cpu;
+
+	/* BZ 161832 workaround: freed IOs must go through ocs_hal_check_sec_hio_list() */
+	if (hal->io_cache == NULL || hal->workaround.use_dif_sec_xri) {
+		return NULL;
+	}
+
+	cpu = ocs_thread_getcpu();
+	if (cpu < 0 || cpu >= OCS_HAL_IO_CACHE_MAX_CPUS) {
+		return NULL;
+	}
+
+	return &hal->io_cache[cpu];
+}
+
+/**
+ * @ingroup io
+ * @brief Drop all IOs held in the per-lcore caches.
+ *
+ * @par Description
+ * Used when the free list is rebuilt; ocs_hal_init_io() re-adds every IO
+ * to hal->io_free.
+ *
+ * @param hal Hardware context.
+ */
+static void
+ocs_hal_io_cache_flush(ocs_hal_t *hal)
+{
+	uint32_t i;
+
+	if (hal->io_cache == NULL) {
+		return;
+	}
+
+	for (i = 0; i < OCS_HAL_IO_CACHE_MAX_CPUS; i++) {
+		hal->io_cache[i].count = 0;
+	}
+}
+
+/**
+ * @ingroup io
+ * @brief Initialize a HAL IO object taken from a free list.
+ *
+ * @param hal Hardware context.
+ * @param io Pointer to the HAL IO object.
+ */
+static inline void
+ocs_hal_io_activate(ocs_hal_t *hal, ocs_hal_io_t *io)
+{
+	ocs_hal_io_set_inuse(hal, io);
+	io->state = OCS_HAL_IO_STATE_INUSE;
+	io->quarantine = FALSE;
+	io->quarantine_first_phase = TRUE;
+	io->abort_reqtag = UINT32_MAX;
+	ocs_ref_init(&io->ref, ocs_hal_io_free_internal, io);
+}
+
 /**
  * @ingroup io
  * @brief Lockless allocate a HAL IO object.
@@ -3293,12 +3433,7 @@ _ocs_hal_io_alloc(ocs_hal_t *hal)
 	ocs_hal_io_t	*io = NULL;
 
 	if (NULL != (io = ocs_list_remove_head(&hal->io_free))) {
-		ocs_list_add_tail(&hal->io_inuse, io);
-		io->state = OCS_HAL_IO_STATE_INUSE;
-		io->quarantine = FALSE;
-		io->quarantine_first_phase = TRUE;
-		io->abort_reqtag = UINT32_MAX;
-		ocs_ref_init(&io->ref, ocs_hal_io_free_internal, io);
+		ocs_hal_io_activate(hal, io);
 	} else {
 		ocs_atomic_add_return(&hal->io_alloc_failed_count, 1);
 	}
@@ -3310,6 +3445,8 @@ _ocs_hal_io_alloc(ocs_hal_t *hal)
  * @brief Allocate a HAL IO object.
  *
  * @par Description
+ * The IO is taken from the calling lcore's cache, which is refilled with
+ * up to OCS_HAL_IO_CACHE_BATCH IOs from hal->io_free when empty.
  * @n @b Note: This function applies to non-port owned XRIs
  * only.
  *
@@ -3321,10 +3458,31 @@ ocs_hal_io_t *
 ocs_hal_io_alloc(ocs_hal_t *hal)
 {
 	ocs_hal_io_t	*io = NULL;
+	ocs_hal_io_cache_t *cache = ocs_hal_io_cache_get(hal);
 
-	ocs_lock(&hal->io_lock);
-		io = _ocs_hal_io_alloc(hal);
-	ocs_unlock(&hal->io_lock);
+	if (cache == NULL) {
+		ocs_lock(&hal->io_lock);
+			io = _ocs_hal_io_alloc(hal);
+		ocs_unlock(&hal->io_lock);
+		return io;
+	}
+
+	if (cache->count == 0) {
+		ocs_lock(&hal->io_lock);
+			while (cache->count < OCS_HAL_IO_CACHE_BATCH &&
+			       NULL != (io = ocs_list_remove_head(&hal->io_free))) {
+				cache->io[cache->count++] = io;
+			}
+		ocs_unlock(&hal->io_lock);
+
+		if (cache->count == 0) {
+			ocs_atomic_add_return(&hal->io_alloc_failed_count, 1);
+			return NULL;
+		}
+	}
+
+	io = cache->io[--cache->count];
+	ocs_hal_io_activate(hal, io);
 
 	return io;
 }
@@ -3454,12 +3612,36 @@ ocs_hal_io_free_internal(void *arg)
 	ocs_hal_io_t *io = (ocs_hal_io_t *)arg;
 	ocs_hal_t *hal = io->hal;
 
+	ocs_hal_io_cache_t *cache;
+	uint32_t i;
+
 	/* perform common cleanup */
 	ocs_hal_io_free_common(hal, io);
 
+	ocs_hal_io_clear_inuse(hal, io);
+
+	/* XRI busy IOs wait on io_wait_free for the XRI_ABORTED CQE */
+	cache = ocs_hal_io_cache_get(hal);
+	if (cache != NULL && !io->xbusy) {
+		io->state = OCS_HAL_IO_STATE_FREE;
+
+		if (cache->count == OCS_HAL_IO_CACHE_DEPTH) {
+			/* return the coldest batch, keep the recently used IOs */
+			ocs_lock(&hal->io_lock);
+				for (i = 0; i < OCS_HAL_IO_CACHE_BATCH; i++) {
+					ocs_list_add_tail(&hal->io_free, cache->io[i]);
+				}
+			ocs_unlock(&hal->io_lock);
+			cache->count -= OCS_HAL_IO_CACHE_BATCH;
+			/* DEPTH is twice BATCH, so the halves do not overlap */
+			ocs_memcpy(&cache->io[0], &cache->io[OCS_HAL_IO_CACHE_BATCH],
+				   cache->count * sizeof(cache->io[0]));
+		}
+		cache->io[cache->count++] = io;
+		return;
+	}
+
 	ocs_lock(&hal->io_lock);
-		/* remove from in-use list */
-		ocs_list_remove(&hal->io_inuse, io);
 		ocs_hal_io_free_move_correct_list(hal, io);
 	ocs_unlock(&hal->io_lock);
 }
@@ -3670,7 +3852,7 @@ ocs_hal_check_sec_hio_list(ocs_hal_t *hal)
 		}
 
 		io = ocs_list_remove_head(&hal->sec_hio_wait_list);
-		ocs_list_add_tail(&hal->io_inuse, io);
+		ocs_hal_io_set_inuse(hal, io);
 		io->state = OCS_HAL_IO_STATE_INUSE;
 		io->sec_hio = sec_io;
 
@@ -4124,7 +4306,7 @@ ocs_hal_io_send(ocs_hal_t *hal, ocs_hal_io_type_e type, ocs_hal_io_t *io,
 				io->sec_iparam = *iparam;
 				io->sec_len = len;
 				ocs_lock(&hal->io_lock);
-					ocs_list_remove(&hal->io_inuse,  io);
+					ocs_hal_io_clear_inuse(hal, io);
 					ocs_list_add_tail(&hal->sec_hio_wait_list, io);
 					io->state = OCS_HAL_IO_STATE_WAIT_SEC_HIO;
 					hal->sec_hio_wait_count++;
@@ -7965,19 +8147,23 @@ ocs_hal_io_get_count(ocs_hal_t *hal, ocs_hal_io_count_type_e io_count_type)
 {
 	ocs_hal_io_t *io = NULL;
 	uint32_t count = 0;
+	uint32_t i;
 
 	ocs_lock(&hal->io_lock);
 
 	switch (io_count_type) {
 	case OCS_HAL_IO_INUSE_COUNT :
-		ocs_list_foreach(&hal->io_inuse, io) {
-			count++;
-		}
+		count = ocs_hal_io_inuse_count(hal);
 		break;
 	case OCS_HAL_IO_FREE_COUNT :
 		 ocs_list_foreach(&hal->io_free, io) {
 			 count++;
 		 }
+		 if (hal->io_cache) {
+			 for (i = 0; i < OCS_HAL_IO_CACHE_MAX_CPUS; i++) {
+				 count += hal->io_cache[i].count;
+			 }
+		 }
 		 break;
 	case OCS_HAL_IO_WAIT_FREE_COUNT :
 		 ocs_list_foreach(&hal->io_wait_free, io) {
@@ -9504,6 +9690,27 @@ ocs_hal_setup_io(ocs_hal_t *hal)
 					__func__, hal->config.n_io, hal->sli.config.wqe_size);
 			return OCS_HAL_RTN_NO_MEMORY;
 		}
+
+		hal->io_inuse = ocs_bitmap_alloc(hal->config.n_io);
+		if (NULL == hal->io_inuse) {
+			ocs_log_err(hal->os, "%s: IO in-use map allocation failed, %d Ios\n",
+					__func__, hal->config.n_io);
+			return OCS_HAL_RTN_NO_MEMORY;
+		}
+
+		/*
+		 * Only cache IOs per lcore when the caches can hold at most a
+		 * quarter of the IOs, so one lcore cannot starve the others.
+		 */
+		if (hal->config.n_io >= ocs_get_num_cpus() * OCS_HAL_IO_CACHE_DEPTH * 4) {
+			hal->io_cache = ocs_malloc_aligned(hal->os,
+							   OCS_HAL_IO_CACHE_MAX_CPUS * sizeof(ocs_hal_io_cache_t),
+							   OCS_CACHE_LINE_SIZE, OCS_M_ZERO | OCS_M_NOWAIT);
+			if (NULL == hal->io_cache) {
+				ocs_log_debug(hal->os, "%s: IO cache allocation failed, using global free list\n",
+					      __func__);
+			}
+		}
 	} else {
 		/* re-use existing IOs, including SGLs */
 		new_alloc = FALSE;
@@ -9604,6 +9811,9 @@ ocs_hal_init_io(ocs_hal_t *hal)
 		}
 	}
 
+	ocs_memset(hal->io_inuse, 0, ((hal->config.n_io + BITMAP_BITS_PER_WORD - 1) / BITMAP_BITS_PER_WORD) * sizeof(ocs_bitmap_t));
+	ocs_hal_io_cache_flush(hal);
+
 	io = hal->io;
 	for (nremaining = hal->config.n_io; nremaining; nremaining -= n) {
 		if (prereg) {
@@ -9753,15 +9963,27 @@ ocs_hal_io_cancel(ocs_hal_t *hal)
 	ocs_hal_io_t	*io = NULL;
 	ocs_hal_io_t	*tmp_io = NULL;
 	uint32_t	iters = 100; // One second limit
+	uint32_t	i;
 
 	/*
 	 * Manually clean up outstanding IO.
-	 * Only walk through list once: the backend will cleanup any IOs when done/abort_done is called.
+	 * Only walk through map once: the backend will cleanup any IOs when done/abort_done is called.
 	 */
+	if (hal->io_inuse == NULL) {
+		return 0;
+	}
+
 	ocs_lock(&hal->io_lock);
-	ocs_list_foreach_safe(&hal->io_inuse, io, tmp_io) {
-		ocs_hal_done_t  done = io->done;
-		ocs_hal_done_t  abort_done = io->abort_done;
+	for (i = 0; i < hal->config.n_io; i++) {
+		ocs_hal_done_t  done;
+		ocs_hal_done_t  abort_done;
+
+		if (!ocs_bitmap_test(hal->io_inuse, i)) {
+			continue;
+		}
+		io = &hal->io[i];
+		done = io->done;
+		abort_done = io->abort_done;
 
 		ocs_hal_io_cancel_cleanup(hal, io);
 
@@ -9783,7 +10005,7 @@ ocs_hal_io_cancel(ocs_hal_t *hal)
 			 * free the IO.
 			 */
 			ocs_hal_io_free_common(hal, io);
-			ocs_list_remove(&hal->io_inuse, io);
+			ocs_hal_io_clear_inuse(hal, io);
 			ocs_hal_io_free_move_correct_list(hal, io);
 		}
 	}
@@ -9808,11 +10030,11 @@ ocs_hal_io_cancel(ocs_hal_t *hal)
 	do {
 		ocs_udelay(10000);
 		iters--;
-	} while (!ocs_list_empty(&hal->io_inuse) && iters);
+	} while (ocs_hal_io_inuse_count(hal) && iters);
 
 	/* Leave a breadcrumb that cleanup is not yet complete. */
-	if (!ocs_list_empty(&hal->io_inuse)) {
-		ocs_log_test(hal->os, "%s: io_inuse list is not empty\n", __func__);
+	if (ocs_hal_io_inuse_count(hal)) {
+		ocs_log_test(hal->os, "%s: io_inuse map is not empty\n", __func__);
 	}
 
 	return 0;
@@ -11420,7 +11642,7 @@ ocs_hal_xri_move_to_port_owned(ocs_hal_t *hal, uint32_t num_xri)
 
 	/*
 	 * Note: We cannot use ocs_hal_io_alloc() because that would place the
-	 *       IO on the io_inuse list. We need to move from the io_free to
+	 *       IO on the io_inuse map. We need to move from the io_free to
 	 *       the io_port_owned list.
 	 */
 	ocs_lock(&hal->io_lock);
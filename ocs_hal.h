@@ -227,6 +227,8 @@ typedef enum {
 	OCS_HAL_LINK_CONFIG_SPEED,
 	OCS_HAL_CONFIG_TOPOLOGY,
 	OCS_HAL_BOUNCE,
+	OCS_HAL_Q_SINGLE_CONSUMER,  /**< EQs/CQs polled by exactly one thread */
+	OCS_HAL_WQ_SINGLE_PRODUCER, /**< WQs written by exactly one thread */
 	OCS_HAL_PORTNUM,
 	OCS_HAL_BIOS_VERSION_STRING,
 	OCS_HAL_SGL_CHAINING_CAPABLE,
@@ -854,6 +856,24 @@ typedef struct {
 	ocs_hal_io_t	*quarantine_ios[OCS_HAL_QUARANTINE_QUEUE_DEPTH];
 } ocs_quarantine_info_t;
 
+/**
+ * @brief Per-lcore cache of free HAL IO objects.
+ *
+ * An lcore allocates from and frees to its own cache without taking
+ * hal->io_lock, and only exchanges OCS_HAL_IO_CACHE_BATCH IOs at a time
+ * with hal->io_free when the cache runs empty or full. Threads without an
+ * lcore id use hal->io_free directly. Each cache fills whole cache lines,
+ * so no line is shared between lcores.
+ */
+#define OCS_HAL_IO_CACHE_MAX_CPUS	128
+#define OCS_HAL_IO_CACHE_BATCH		16
+#define OCS_HAL_IO_CACHE_DEPTH		(2 * OCS_HAL_IO_CACHE_BATCH)
+
+typedef struct {
+	uint32_t	count;
+	ocs_hal_io_t	*io[OCS_HAL_IO_CACHE_DEPTH];
+} __attribute__((aligned(OCS_CACHE_LINE_SIZE))) ocs_hal_io_cache_t;
+
 /**
  * @brief Define the WQ callback object
  */
@@ -899,6 +919,8 @@ struct ocs_hal_s {
 		uint8_t		i_only_aab; /** Enable initiator-only auto-abort */
 		uint8_t		emulate_tgt_wqe_timeout; /** Enable driver target wqe timeouts */
 		uint32_t	bounce:1;
+		uint8_t		q_single_consumer; /** EQs/CQs read by one poller thread, no queue lock */
+		uint8_t		wq_single_producer; /** WQs written by one thread, no queue lock */
 		const char      *queue_topology;
 		uint8_t		auto_xfer_rdy_t10_enable;	/** Enable t10 PI for auto xfer ready */
 		uint8_t		auto_xfer_rdy_p_type;	/** p_type for auto xfer ready */
@@ -1007,7 +1029,8 @@ struct ocs_hal_s {
 
 	ocs_lock_t	io_lock;		/**< IO lock to synchronize list access */
 	ocs_lock_t	io_abort_lock;		/**< IO lock to synchronize IO aborting */
-	ocs_list_t	io_inuse;		/**< List of IO objects in use */
+	ocs_bitmap_t	*io_inuse;		/**< Bitmap of IO objects in use, indexed by XRI offset */
+	ocs_hal_io_cache_t *io_cache;		/**< Per-lcore free IO caches, NULL when disabled */
 	ocs_list_t	io_timed_wqe;		/**< List of IO objects with a timed target WQE */
 	ocs_list_t	io_wait_free;		/**< List of IO objects waiting to be freed */
 	ocs_list_t	io_free;		/**< List of IO objects available for allocation */
@@ -1086,6 +1109,8 @@ struct hal_eq_s {
 	uint32_t use_count;
 #endif
 	ocs_varray_t *wq_array;		/*<< array of WQs */
+	uint64_t poll_idle_enter;	/*<< poller busy -> timed switches */
+	uint64_t poll_timed;		/*<< polls done by a timed poller */
 };
 
 struct hal_cq_s {
@@ -1217,6 +1242,7 @@ extern hal_cq_t *hal_new_cq(hal_eq_t *eq, uint32_t entry_count);
 extern uint32_t hal_new_cq_set(hal_eq_t *eqs[], hal_cq_t *cqs[], uint32_t num_cqs, uint32_t entry_count);
 extern hal_mq_t *hal_new_mq(hal_cq_t *cq, uint32_t entry_count);
 extern hal_wq_t *hal_new_wq(hal_cq_t *cq, uint32_t entry_count, uint32_t class, uint32_t ulp);
+extern void hal_eq_release_owner(hal_eq_t *eq);
 extern hal_rq_t *hal_new_rq(hal_cq_t *cq, uint32_t entry_count, uint32_t ulp);
 extern uint32_t hal_new_rq_set(hal_cq_t *cqs[], hal_rq_t *rqs[], uint32_t num_rq_pairs, uint32_t entry_count, uint32_t ulp);
 extern void hal_del_eq(hal_eq_t *eq);
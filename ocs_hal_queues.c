@@ -392,6 +392,7 @@ hal_new_eq(ocs_hal_t *hal, uint32_t entry_count)
 				ocs_free(hal->os, eq, sizeof(*eq));
 				eq = NULL;
 			} else {
+				sli_queue_set_single_owner(eq->queue, hal->config.q_single_consumer);
 				sli_eq_modify_delay(&hal->sli, eq->queue, 1, 0, 8);
 				hal->hal_eq[eq->instance] = eq;
 				ocs_list_add_tail(&hal->eq_list, eq);
@@ -435,6 +436,7 @@ hal_new_cq(hal_eq_t *eq, uint32_t entry_count)
 			ocs_free(hal->os, cq, sizeof(*cq));
 			cq = NULL;
 		} else {
+			sli_queue_set_single_owner(cq->queue, hal->config.q_single_consumer);
 			hal->hal_cq[cq->instance] = cq;
 			ocs_list_add_tail(&eq->cq_list, cq);
 			ocs_log_debug(hal->os, "create cq[%2d] id %3d len %4d\n", cq->instance, cq->queue->id,
@@ -490,6 +492,7 @@ hal_new_cq_set(hal_eq_t *eqs[], hal_cq_t *cqs[], uint32_t num_cqs, uint32_t entr
 	}
 
 	for (i = 0; i < num_cqs; i++) {
+		sli_queue_set_single_owner(cqs[i]->queue, hal->config.q_single_consumer);
 		hal->hal_cq[cqs[i]->instance] = cqs[i];
 		ocs_list_add_tail(&cqs[i]->eq->cq_list, cqs[i]);
 	}
@@ -585,6 +588,7 @@ hal_new_wq(hal_cq_t *cq, uint32_t entry_count, uint32_t class, uint32_t ulp)
 			ocs_free(hal->os, wq, sizeof(*wq));
 			wq = NULL;
 		} else {
+			sli_queue_set_single_owner(wq->queue, hal->config.wq_single_producer);
 			hal->hal_wq[wq->instance] = wq;
 			ocs_list_add_tail(&cq->q_list, wq);
 			ocs_log_debug(hal->os, "create wq[%2d] id %3d len %4d cls %d ulp %d\n", wq->instance, wq->queue->id,
@@ -594,6 +598,34 @@ hal_new_wq(hal_cq_t *cq, uint32_t entry_count, uint32_t class, uint32_t ulp)
 	return wq;
 }
 
+/**
+ * @brief Release ownership of an EQ and its child queues
+ *
+ * Called by the thread that polled the EQ when it stops doing so, so that
+ * another thread (e.g. the shutdown path) can take the single owner queues
+ * over without tripping the debug owner check.
+ *
+ * @param eq pointer to EQ object
+ *
+ * @return none
+ */
+void
+hal_eq_release_owner(hal_eq_t *eq)
+{
+	hal_cq_t *cq;
+	hal_q_t *q;
+
+	sli_queue_release_owner(eq->queue);
+	ocs_list_foreach(&eq->cq_list, cq) {
+		sli_queue_release_owner(cq->queue);
+		ocs_list_foreach(&cq->q_list, q) {
+			if (q->type == SLI_QTYPE_WQ) {
+				sli_queue_release_owner(((hal_wq_t *)q)->queue);
+			}
+		}
+	}
+}
+
 /**
  * @brief Allocate a hal_rq_t object
  *
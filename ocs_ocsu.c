@@ -72,10 +72,24 @@ struct ocs_spdk_device
 	TAILQ_ENTRY(ocs_spdk_device) tailq;
 };
 
+/*
+ * Hybrid polling: an empty EQ skips ocs_hal_process(), and once an EQ has
+ * been empty for OCS_POLLER_IDLE_POLLS consecutive polls the busy poller is
+ * replaced by a timed one running every OCS_POLLER_IDLE_PERIOD_US, so an
+ * idle EQ is polled less often. The reactor and the NVMf hwqp pollers on
+ * the same core keep spinning. The first event seen switches back to busy
+ * polling, so the added wake-up latency is bounded by the period.
+ */
+#define OCS_POLLER_IDLE_POLLS		10000
+#define OCS_POLLER_IDLE_PERIOD_US	100
+
 struct ocs_spdk_fc_poller
 {
 	struct spdk_poller *spdk_poller;
 	uint32_t lcore;
+	hal_eq_t *hal_eq;
+	uint32_t idle_polls;	/* consecutive empty polls */
+	bool idle;		/* running as a timed poller */
 };
 
 static TAILQ_HEAD(, ocs_spdk_device)g_devices;
@@ -214,12 +228,60 @@ ocs_spdk_fc_poller(void *arg)
 	return 0;
 }
 
+static int ocs_spdk_fc_hybrid_poller(void *arg);
+
+static void
+ocs_spdk_fc_poller_set_idle(struct ocs_spdk_fc_poller *poller, bool idle)
+{
+	spdk_poller_unregister(&poller->spdk_poller);
+	poller->spdk_poller = spdk_poller_register(ocs_spdk_fc_hybrid_poller, poller,
+						   idle ? OCS_POLLER_IDLE_PERIOD_US : 0);
+	poller->idle = idle;
+	poller->idle_polls = 0;
+	if (idle) {
+		poller->hal_eq->poll_idle_enter++;
+	}
+
+	ocs_log_debug(poller->hal_eq->hal->os, "EQ %d poller %s (idle switches %" PRIu64
+		      ", timed polls %" PRIu64 ")\n", poller->hal_eq->instance,
+		      idle ? "timed" : "busy", poller->hal_eq->poll_idle_enter,
+		      poller->hal_eq->poll_timed);
+}
+
+static int
+ocs_spdk_fc_hybrid_poller(void *arg)
+{
+	struct ocs_spdk_fc_poller *poller = arg;
+	hal_eq_t *hal_eq = poller->hal_eq;
+	ocs_hal_t *hal = hal_eq->hal;
+
+	if (poller->idle) {
+		hal_eq->poll_timed++;
+	}
+
+	/* The EQ is left armed by the last ocs_hal_process() */
+	if (sli_queue_is_empty(&hal->sli, hal_eq->queue)) {
+		if (!poller->idle && (++poller->idle_polls >= OCS_POLLER_IDLE_POLLS)) {
+			ocs_spdk_fc_poller_set_idle(poller, true);
+		}
+		return 0;
+	}
+
+	if (poller->idle) {
+		ocs_spdk_fc_poller_set_idle(poller, false);
+	}
+	poller->idle_polls = 0;
+
+	return ocs_spdk_fc_poller(hal_eq);
+}
+
 static void
 _ocs_poller_stop(void *arg1, void *arg2)
 {
 	struct ocs_spdk_fc_poller *fc_poller = arg1;
 
 	spdk_poller_unregister(&fc_poller->spdk_poller);
+	hal_eq_release_owner(fc_poller->hal_eq);
 	ocs_release_lcore(fc_poller->lcore);
 	sem_post((sem_t *) arg2);
 }
@@ -266,7 +328,11 @@ static void
 ocs_delay_poller_start(void *arg1, void *arg2)
 {
 	struct ocs_spdk_fc_poller *poller = arg1;
-	poller->spdk_poller = spdk_poller_register(ocs_spdk_fc_poller, arg2, 0);
+
+	poller->hal_eq = arg2;
+	poller->idle = false;
+	poller->idle_polls = 0;
+	poller->spdk_poller = spdk_poller_register(ocs_spdk_fc_hybrid_poller, poller, 0);
 	if (ocs_rsvd_thread == NULL &&
 	    spdk_env_get_current_core() == spdk_env_get_last_core()) {
 		/* save last thread (reserved for SCSI) */
@@ -44,6 +44,8 @@
 #include "spdk/event.h"
 #include "spdk/io_channel.h"
 
+#include <sys/eventfd.h>
+
 /* @brief Select DMA buffer allocation method
  */
 #define ENABLE_DMABUF_SLAB		1
@@ -796,6 +798,148 @@ ocs_sem_init(ocs_sem_t *sem, int val, const char *name, ...)
 	return sem_init(&sem->sem, 0, val);
 }
 
+/**
+ * @brief initialize an OCS message queue
+ *
+ * Allocates the message ring and the eventfd used to wake the consumer.
+ *
+ * @param q pointer to message queue
+ *
+ * @return returns 0 for success, a negative error code value for failure.
+ */
+int32_t
+ocs_mqueue_init(ocs_mqueue_t *q)
+{
+	ocs_memset(q, 0, sizeof(*q));
+	q->efd = -1;
+
+	q->ring = spdk_ring_create(SPDK_RING_TYPE_MP_SC, OCS_MQUEUE_DEPTH, SPDK_ENV_SOCKET_ID_ANY);
+	if (q->ring == NULL) {
+		ocs_log_err(NULL, "%s: spdk_ring_create() failed\n", __func__);
+		return -1;
+	}
+
+	q->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (q->efd < 0) {
+		ocs_log_err(NULL, "%s: eventfd() failed: %s\n", __func__, strerror(errno));
+		spdk_ring_free(q->ring);
+		q->ring = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief wake a sleeping message queue consumer
+ *
+ * Called by a producer that cleared the consumer's sleeping flag.
+ *
+ * @param q pointer to message queue
+ */
+void
+ocs_mqueue_wake(ocs_mqueue_t *q)
+{
+	uint64_t one = 1;
+
+	if (write(q->efd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN) {
+		ocs_log_err(NULL, "%s: eventfd write failed: %s\n", __func__, strerror(errno));
+	}
+}
+
+/**
+ * @brief wait for messages on an empty message queue
+ *
+ * Slow path of ocs_mqueue_get_burst(). The consumer publishes its sleeping flag, re-checks the
+ * ring, and only then blocks on the eventfd, so a producer that enqueues after the re-check is
+ * guaranteed to see the flag and wake it.
+ *
+ * @param q pointer to message queue
+ * @param msgdata array receiving the message data pointers
+ * @param count size of the msgdata array
+ * @param timeout_usec timeout (< 0 try forever, > 0 try micro-seconds)
+ *
+ * @return returns the number of messages read
+ */
+uint32_t
+ocs_mqueue_wait_burst(ocs_mqueue_t *q, void **msgdata, uint32_t count, int32_t timeout_usec)
+{
+	struct pollfd pfd = { .fd = q->efd, .events = POLLIN };
+	struct timespec now;
+	uint64_t deadline_usec = 0;
+	uint64_t now_usec;
+	uint64_t val;
+	int32_t wait_msec = -1;
+	uint32_t n;
+
+	if (timeout_usec > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		deadline_usec = (now.tv_sec * 1000000ull) + (now.tv_nsec / 1000) + timeout_usec;
+	}
+
+	for (;;) {
+		__atomic_store_n(&q->sleeping, 1, __ATOMIC_RELAXED);
+		/* pairs with the fence in ocs_mqueue_put() */
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+		n = spdk_ring_dequeue(q->ring, msgdata, count);
+		if (n != 0) {
+			__atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+			return n;
+		}
+
+		if (timeout_usec > 0) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			now_usec = (now.tv_sec * 1000000ull) + (now.tv_nsec / 1000);
+			if (now_usec >= deadline_usec) {
+				__atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+				return 0;
+			}
+			wait_msec = (deadline_usec - now_usec + 999) / 1000;
+		}
+
+		if (poll(&pfd, 1, wait_msec) > 0) {
+			/* drain the counter; a stale wakeup (EAGAIN) only costs one extra pass */
+			if (read(q->efd, &val, sizeof(val)) != sizeof(val) && errno != EAGAIN) {
+				ocs_log_err(NULL, "%s: eventfd read failed: %s\n", __func__, strerror(errno));
+			}
+		}
+		__atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+
+		n = spdk_ring_dequeue(q->ring, msgdata, count);
+		if (n != 0) {
+			return n;
+		}
+	}
+}
+
+/**
+ * @brief free an OCS message queue
+ *
+ * The message queue and its resources are free'd.   In this case, the message queue is
+ * drained, and all the messages free'd
+ *
+ * @param q pointer to message queue
+ *
+ * @return none
+ */
+void
+ocs_mqueue_free(ocs_mqueue_t *q)
+{
+	void *msgdata;
+
+	if (q->ring != NULL) {
+		while (spdk_ring_dequeue(q->ring, &msgdata, 1) == 1) {
+			ocs_log_test(NULL, "Warning: freeing message queue, payload %p may leak\n", msgdata);
+		}
+		spdk_ring_free(q->ring);
+		q->ring = NULL;
+	}
+	if (q->efd >= 0) {
+		close(q->efd);
+		q->efd = -1;
+	}
+}
+
 int
 ocs_spdk_timer_cb(void *arg)
 {
@@ -140,6 +140,7 @@ typedef void * ocs_os_handle_t;
 /* Linux driver specific definitions */
 
 #define OCS_MIN_DMA_ALIGNMENT		16
+#define OCS_CACHE_LINE_SIZE		64
 #define OCS_MAX_DMA_ALLOC		(64*1024)	/* maxium DMA allocation that is expected to reliably succeed  */
 
 #define OCS_MAX_LUN			256
@@ -519,6 +520,38 @@ ocs_malloc(ocs_os_handle_t os, size_t size, int32_t flags)
 	return ptr;
 }
 
+/**
+ * @ingroup os
+ * @brief Allocate host memory aligned to a power of 2 boundary
+ *
+ * @param os OS context
+ * @param size number of bytes to allocate
+ * @param align alignment in bytes, a power of 2 multiple of sizeof(void *)
+ * @param flags additional options, as for ocs_malloc()
+ *
+ * The memory is released with ocs_free().
+ *
+ * @return pointer to allocated memory, NULL otherwise
+ */
+static inline void *
+ocs_malloc_aligned(ocs_os_handle_t os, size_t size, size_t align, int32_t flags)
+{
+	void	*ptr = NULL;
+
+	if (posix_memalign(&ptr, align, size)) {
+		return NULL;
+	}
+
+	if (flags & OCS_M_ZERO) {
+		memset(ptr, 0, size);
+	}
+
+#ifdef OCS_DEBUG_MEMORY
+	ocs_track_memory_allocation(ptr, size, FALSE, __builtin_return_address(0));
+#endif
+	return ptr;
+}
+
 /**
  * @ingroup os
  * @brief Free host memory
@@ -847,7 +880,7 @@ ocs_sem_p(ocs_sem_t *sem, int32_t timeout_usec)
 		/* Compute abstime for timeout */
 		clock_gettime (CLOCK_REALTIME, & ts);
 		ts.tv_sec += (timeout_usec / 1000000);
-		ts.tv_nsec += (timeout_usec % 1000000);
+		ts.tv_nsec += (timeout_usec % 1000000) * 1000;
 		if (ts.tv_nsec >= 1000000000l) {
 			ts.tv_sec++;
 			ts.tv_nsec -= 1000000000l;
@@ -1002,6 +1035,78 @@ ocs_bitmap_find(ocs_bitmap_t *bitmap, uint32_t n_bits)
 	return idx;
 }
 
+/**
+ * @ingroup os
+ * @brief test the specified bit
+ *
+ * @param bitmap pointer to bit map
+ * @param bit bit number to test
+ *
+ * @return TRUE if the bit is set, FALSE otherwise
+ */
+static inline uint8_t
+ocs_bitmap_test(ocs_bitmap_t *bitmap, uint32_t bit)
+{
+	uint32_t idx = bit / BITMAP_BITS_PER_WORD;
+	ocs_bitmap_t mask = (1U << (bit % BITMAP_BITS_PER_WORD));
+	return (__atomic_load_n(&bitmap[idx], __ATOMIC_ACQUIRE) & mask) != 0;
+}
+
+/**
+ * @ingroup os
+ * @brief atomically set the specified bit
+ *
+ * @param bitmap pointer to bit map
+ * @param bit bit number to set
+ */
+static inline void
+ocs_bitmap_set_atomic(ocs_bitmap_t *bitmap, uint32_t bit)
+{
+	uint32_t idx = bit / BITMAP_BITS_PER_WORD;
+	ocs_bitmap_t mask = (1U << (bit % BITMAP_BITS_PER_WORD));
+	__atomic_fetch_or(&bitmap[idx], mask, __ATOMIC_RELEASE);
+}
+
+/**
+ * @ingroup os
+ * @brief atomically clear the specified bit
+ *
+ * @param bitmap pointer to bit map
+ * @param bit bit number to clear
+ */
+static inline void
+ocs_bitmap_clear_atomic(ocs_bitmap_t *bitmap, uint32_t bit)
+{
+	uint32_t idx = bit / BITMAP_BITS_PER_WORD;
+	ocs_bitmap_t mask = (1U << (bit % BITMAP_BITS_PER_WORD));
+	__atomic_fetch_and(&bitmap[idx], ~mask, __ATOMIC_RELEASE);
+}
+
+/**
+ * @ingroup os
+ * @brief count the set bits of a bit map
+ *
+ * The words are read one at a time, so bits changed concurrently may or
+ * may not be counted.
+ *
+ * @param bitmap pointer to bit map
+ * @param n_bits number of bits in map
+ *
+ * @return number of set bits
+ */
+static inline uint32_t
+ocs_bitmap_count(ocs_bitmap_t *bitmap, uint32_t n_bits)
+{
+	uint32_t nwords = (n_bits + BITMAP_BITS_PER_WORD - 1) / BITMAP_BITS_PER_WORD;
+	uint32_t count = 0;
+	uint32_t i;
+
+	for (i = 0; i < nwords; i++) {
+		count += __builtin_popcount(__atomic_load_n(&bitmap[i], __ATOMIC_RELAXED));
+	}
+	return count;
+}
+
 extern int32_t ocs_get_property(const char *prop_name, char *buffer, uint32_t buffer_len);
 
 /***************************************************************************
@@ -1086,9 +1191,14 @@ ocs_msectime(void)
  *
  */
 
+/*
+ * Atomics are plain 32-bit integers updated with the compiler __atomic
+ * builtins. Read-modify-write operations are acq_rel so that a caller
+ * acting on the result (e.g. freeing an object when a count hits zero)
+ * sees every write made before the other threads' updates.
+ */
 typedef struct ocs_atomic_s {
 	int32_t value;
-	ocs_lock_t lock;
 } ocs_atomic_t;
 
 /**
@@ -1103,8 +1213,7 @@ typedef struct ocs_atomic_s {
 static inline void
 ocs_atomic_init(ocs_atomic_t *a, int v)
 {
-	ocs_lock_init(NULL, &a->lock, "atomic_lock");
-	a->value = v;
+	__atomic_store_n(&a->value, v, __ATOMIC_RELAXED);
 }
 
 /**
@@ -1119,12 +1228,7 @@ ocs_atomic_init(ocs_atomic_t *a, int v)
 static inline int
 ocs_atomic_add_return(ocs_atomic_t *a, int v)
 {
-	uint32_t _v;
-	ocs_lock(&a->lock);
-		_v = a->value;
-		a->value += v;
-	ocs_unlock(&a->lock);
-	return _v;
+	return __atomic_fetch_add(&a->value, v, __ATOMIC_ACQ_REL);
 }
 
 /**
@@ -1151,12 +1255,7 @@ ocs_atomic_add_return(ocs_atomic_t *a, int v)
 static inline int
 ocs_atomic_sub_and_test(ocs_atomic_t *a, int i)
 {
-	int v;
-	ocs_lock(&a->lock);
-		a->value -= i;
-		v = a->value;
-	ocs_unlock(&a->lock);
-	return (v == 0);
+	return (__atomic_sub_fetch(&a->value, i, __ATOMIC_ACQ_REL) == 0);
 }
 
 /**
@@ -1173,14 +1272,15 @@ ocs_atomic_sub_and_test(ocs_atomic_t *a, int i)
 static inline int
 ocs_atomic_add_unless(ocs_atomic_t *a, int i, int v)
 {
-	int rc = 0;
-	ocs_lock(&a->lock);
-		if (a->value != v) {
-			a->value += i;
-			rc = 1;
+	int32_t cur = __atomic_load_n(&a->value, __ATOMIC_RELAXED);
+
+	do {
+		if (cur == v) {
+			return 0;
 		}
-	ocs_unlock(&a->lock);
-	return rc;
+	} while (!__atomic_compare_exchange_n(&a->value, &cur, cur + i, TRUE,
+					      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+	return 1;
 }
 
 /**
@@ -1194,12 +1294,7 @@ ocs_atomic_add_unless(ocs_atomic_t *a, int i, int v)
 static inline int
 ocs_atomic_read_and_clear(ocs_atomic_t *a)
 {
-	uint32_t _v;
-	ocs_lock(&a->lock);
-		_v = a->value;
-		a->value = 0;
-	ocs_unlock(&a->lock);
-	return _v;
+	return __atomic_exchange_n(&a->value, 0, __ATOMIC_ACQ_REL);
 }
 
 /**
@@ -1213,11 +1308,7 @@ ocs_atomic_read_and_clear(ocs_atomic_t *a)
 static inline int
 ocs_atomic_read(ocs_atomic_t *a)
 {
-	int _v;
-	ocs_lock(&a->lock);
-		_v = a->value;
-	ocs_unlock(&a->lock);
-	return _v;
+	return __atomic_load_n(&a->value, __ATOMIC_ACQUIRE);
 }
 
 /**
@@ -1227,7 +1318,7 @@ ocs_atomic_read(ocs_atomic_t *a)
  * @param a    pointer to the atomic object
  * @param v    value to store
  */
-#define ocs_atomic_set(a, v)		(a)->value = v
+#define ocs_atomic_set(a, v)		__atomic_store_n(&(a)->value, (v), __ATOMIC_RELEASE)
 
 
 #define ARRAY_SIZE(x)	(sizeof(x) / sizeof(x[0]))
@@ -1238,91 +1329,94 @@ ocs_atomic_read(ocs_atomic_t *a)
  */
 
 /**
- * @brief OCS message queue message
- *
+ * @brief Default number of messages an OCS message queue can hold
  */
-
-typedef struct ocs_mqueue_hdr_s {
-	ocs_list_link_t link;			/**< linked list link */
-	void *msgdata;				/**< message data (payload) */
-} ocs_mqueue_hdr_t;
+#define OCS_MQUEUE_DEPTH		1024
 
 /**
  * @brief OCS message queue object
  *
- * The OCS message queue may be used to pass messages between two threads (or an ISR and thread).
- * A message is defined here as a pointer to an instance of application specific data (message data).
- * The message queue allocates a message header, saves the message data pointer, and places the
- * header on the message queue's linked list.   A counting semaphore is used to synchronize access
- * to the message queue consumer.
+ * The OCS message queue may be used to pass messages from any number of producer threads to a
+ * single consumer thread. A message is defined here as a pointer to an instance of application
+ * specific data (message data). Messages are held in a bounded multi-producer/single-consumer
+ * ring, so neither side allocates memory or takes a lock. The consumer only sleeps on the eventfd
+ * when the ring is empty, and producers only write the eventfd when they see the consumer's
+ * sleeping flag set.
  *
  */
 
 typedef struct ocs_mqueue_s {
 	ocs_os_handle_t os;
-	ocs_lock_t lock;		/**< message queue lock */
-	ocs_sem_t prod_sem;		/**< producer semaphore */
-	ocs_list_t queue;		/**< list of messages */
+	struct spdk_ring *ring;		/**< ring of message data pointers */
+	int efd;			/**< eventfd used to wake the consumer */
+	uint32_t sleeping;		/**< set while the consumer waits on efd */
 } ocs_mqueue_t;
 
+extern int32_t ocs_mqueue_init(ocs_mqueue_t *q);
+extern void ocs_mqueue_wake(ocs_mqueue_t *q);
+extern uint32_t ocs_mqueue_wait_burst(ocs_mqueue_t *q, void **msgdata, uint32_t count, int32_t timeout_usec);
+extern void ocs_mqueue_free(ocs_mqueue_t *q);
+
 /**
- * @brief initialize an OCS message queue
+ * @brief put a message in a message queue
  *
- * The elements of the message queue  are initialized
+ * The message data pointer is placed on the message queue's ring, and the consumer woken if it is
+ * sleeping. May be called from any number of threads concurrently.
  *
  * @param q pointer to message queue
+ * @param msgdata pointer to message data
  *
- * @return returns 0 for success, a negative error code value for failure.
+ * @return returns 0 for success, a negative error code value for failure (queue full).
  */
 
 static inline int32_t
-ocs_mqueue_init(ocs_mqueue_t *q)
+ocs_mqueue_put(ocs_mqueue_t *q, void *msgdata)
 {
-	ocs_memset(q, 0, sizeof(*q));
-	ocs_lock_init(NULL, &q->lock, "mqueue_lock");
-	ocs_sem_init(&q->prod_sem, 0, "mqueue_prod");
-	ocs_list_init(&q->queue, ocs_mqueue_hdr_t, link);
+	if (spdk_ring_enqueue(q->ring, &msgdata, 1, NULL) != 1) {
+		ocs_log_err(NULL, "%s: message queue full\n", __func__);
+		return -1;
+	}
+
+	/* pairs with the fence in ocs_mqueue_wait_burst() */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&q->sleeping, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&q->sleeping, 0, __ATOMIC_ACQ_REL)) {
+		ocs_mqueue_wake(q);
+	}
 	return 0;
 }
 
 /**
- * @brief put a message in a message queue
+ * @brief read up to count messages
  *
- * A message header is allocated, it's payload set to point to the requested message data, and the
- * header posted to the message queue.
+ * Reads as many as count messages from the message queue, or times out. The timeout_usec value
+ * if zero will try one time, if negative will try forever, and if positive will try for that many
+ * micro-seconds. Only one thread may consume from a message queue.
  *
  * @param q pointer to message queue
- * @param msgdata pointer to message data
+ * @param msgdata array receiving the message data pointers
+ * @param count size of the msgdata array
+ * @param timeout_usec timeout (0 - try once, < 0 try forever, > 0 try micro-seconds)
  *
- * @return returns 0 for success, a negative error code value for failure.
+ * @return returns the number of messages read
  */
 
-static inline int32_t
-ocs_mqueue_put(ocs_mqueue_t *q, void *msgdata)
+static inline uint32_t
+ocs_mqueue_get_burst(ocs_mqueue_t *q, void **msgdata, uint32_t count, int32_t timeout_usec)
 {
-	ocs_mqueue_hdr_t *hdr = NULL;
-
-	hdr = ocs_malloc(q->os, sizeof(*hdr), OCS_M_NOWAIT | OCS_M_ZERO);
+	uint32_t n;
 
-	if (hdr == NULL) {
-		ocs_log_err(NULL, "%s: ocs_malloc() failed\n", __func__);
-		return -1;
+	n = spdk_ring_dequeue(q->ring, msgdata, count);
+	if (n == 0 && timeout_usec != 0) {
+		n = ocs_mqueue_wait_burst(q, msgdata, count, timeout_usec);
 	}
-
-	hdr->msgdata = msgdata;
-
-	/* lock the queue wide lock, add to tail of linked list and increment the semaphore */
-	ocs_lock(&q->lock);
-		ocs_list_add_tail(&q->queue, hdr);
-	ocs_unlock(&q->lock);
-	ocs_sem_v(&q->prod_sem);
-	return 0;
+	return n;
 }
 
 /**
  * @brief read next message
  *
- * Reads next message header from the message queue, or times out.  The timeout_usec value
+ * Reads next message from the message queue, or times out.  The timeout_usec value
  * if zero will try one time, if negative will try forever, and if positive will try
  * for that many micro-seconds.
  *
@@ -1335,8 +1429,6 @@ ocs_mqueue_put(ocs_mqueue_t *q, void *msgdata)
 static inline void *
 ocs_mqueue_get(ocs_mqueue_t *q, int32_t timeout_usec)
 {
-	int32_t rc;
-	ocs_mqueue_hdr_t *hdr = NULL;
 	void *msgdata = NULL;
 
 	if (q == NULL) {
@@ -1344,49 +1436,12 @@ ocs_mqueue_get(ocs_mqueue_t *q, int32_t timeout_usec)
 		return NULL;
 	}
 
-	rc = ocs_sem_p(&q->prod_sem, timeout_usec);
-	if (rc != 0) {
+	if (ocs_mqueue_get_burst(q, &msgdata, 1, timeout_usec) == 0) {
 		return NULL;
 	}
-
-	ocs_lock(&q->lock);
-	if (!ocs_list_empty(&q->queue)) {
-		hdr = ocs_list_get_head(&q->queue);
-		ocs_list_remove_head(&q->queue);
-	}
-	ocs_unlock(&q->lock);
-	if (hdr != NULL) {
-		msgdata = hdr->msgdata;
-		ocs_free(q->os, hdr, sizeof(*hdr));
-	}
 	return msgdata;
 }
 
-/**
- * @brief free an OCS message queue
- *
- * The message queue and its resources are free'd.   In this case, the message queue is
- * drained, and all the messages free'd
- *
- * @param q pointer to message queue
- *
- * @return none
- */
-
-static inline void
-ocs_mqueue_free(ocs_mqueue_t *q)
-{
-	ocs_mqueue_hdr_t *hdr;
-	ocs_mqueue_hdr_t *next;
-
-	ocs_lock(&q->lock);
-	ocs_list_foreach_safe(&q->queue, hdr, next) {
-		ocs_log_test(NULL, "Warning: freeing message queue, payload %p may leak\n", hdr->msgdata);
-		ocs_free(q->os, hdr, sizeof(*hdr));
-	}
-	ocs_unlock(&q->lock);
-}
-
 /***************************************************************************
  * Threading
  *
@@ -1704,7 +1759,8 @@ ocs_ref_set(ocs_ref_t *ref, int i)
 static inline void
 ocs_ref_get(ocs_ref_t *ref)
 {
-	ocs_atomic_add_return(&ref->count, 1);
+	/* The caller already holds a reference, so no ordering is needed */
+	__atomic_fetch_add(&ref->count.value, 1, __ATOMIC_RELAXED);
 }
 
 /**
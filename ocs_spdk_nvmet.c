@@ -59,6 +59,7 @@ ocs_fill_nvme_sli_queue(ocs_t *ocs,
 	sli_q->size = sli4_q->size;
 	sli_q->address	= sli4_q->dma.virt;
 	sli_q->max_entries = sli4_q->length;
+	sli_q->mask = sli4_q->length - 1;
 	sli_q->doorbell_reg =
 		ocs->ocs_os.bars[sli4_q->doorbell_rset].vaddr +
 		sli4_q->doorbell_offset;
@@ -129,11 +130,13 @@ ocs_hw_port_cleanup(ocs_t *ocs)
 		struct bcm_nvmf_hw_queues* hwq;
 
  		hwq = (struct bcm_nvmf_hw_queues *)(ocs->tgt_ocs.args->ls_queue);
+		spdk_nvmf_fc_fini_q(hwq);
 		ocs_free_nvme_buffers(hwq->rq_hdr.q.name, hwq->rq_hdr.buffer);
 		ocs_free_nvme_buffers(hwq->rq_payload.q.name, hwq->rq_payload.buffer);
 
 		for (i = 0; i < ocs->num_cores; i ++) {
 			hwq = (struct bcm_nvmf_hw_queues *)(ocs->tgt_ocs.args->io_queues[i]); 
+			spdk_nvmf_fc_fini_q(hwq);
 			ocs_free_nvme_buffers(hwq->rq_hdr.q.name, hwq->rq_hdr.buffer);
 			ocs_free_nvme_buffers(hwq->rq_payload.q.name, hwq->rq_payload.buffer);
 		}
@@ -70,6 +70,7 @@ static int32_t ocs_purge_pending(ocs_t *ocs, ocs_list_t *pend_list, ocs_lock_t *
 static int32_t ocs_sframe_send_task_set_full_or_busy(ocs_node_t *node, ocs_hal_sequence_t *seq);
 
 #define OCS_MAX_FRAMES_BEFORE_YEILDING 10000
+#define OCS_UNSOL_RQ_BURST 32
 
 /**
  * @brief Process the RQ circular buffer and process the incoming frames.
@@ -83,25 +84,31 @@ ocs_unsol_rq_thread(ocs_thread_t *mythread)
 {
 	ocs_xport_rq_thread_info_t *thread_data = mythread->arg;
 	ocs_t *ocs = thread_data->ocs;
-	ocs_hal_sequence_t *seq;
+	ocs_hal_sequence_t *seq[OCS_UNSOL_RQ_BURST];
 	uint32_t yield_count = OCS_MAX_FRAMES_BEFORE_YEILDING;
+	uint32_t count;
+	uint32_t i;
 
 	ocs_log_debug(ocs, "%s %s: running\n", __func__, mythread->name);
 	while (!ocs_thread_terminate_requested(mythread)) {
-		seq = ocs_cbuf_get(thread_data->seq_cbuf, 100000);
-		if (seq == NULL) {
+		count = ocs_cbuf_get_burst(thread_data->seq_cbuf, (void **)seq, OCS_UNSOL_RQ_BURST, 100000);
+		if (count == 0) {
 			/* Prevent soft lockups by yielding the CPU */
 			ocs_thread_yield(&thread_data->thread);
 			yield_count = OCS_MAX_FRAMES_BEFORE_YEILDING;
 			continue;
 		}
-		/* Note: Always returns 0 */
-		ocs_unsol_process((ocs_t*)seq->hal->os, seq);
+		for (i = 0; i < count; i++) {
+			/* Note: Always returns 0 */
+			ocs_unsol_process((ocs_t*)seq[i]->hal->os, seq[i]);
+		}
 
 		/* We have to prevent CPU soft lockups, so just yield the CPU after x frames. */
-		if (--yield_count == 0) {
+		if (yield_count <= count) {
 			ocs_thread_yield(&thread_data->thread);
 			yield_count = OCS_MAX_FRAMES_BEFORE_YEILDING;
+		} else {
+			yield_count -= count;
 		}
 	}
 	ocs_log_debug(ocs, "%s %s: exiting\n", __func__, mythread->name);
@@ -4982,7 +4982,7 @@ sli_queue_is_empty(sli4_t *sli4, sli4_queue_t *q)
 	int32_t		rc = TRUE;
 	uint8_t		*qe = q->dma.virt;
 
-	ocs_lock(&q->lock);
+	_sli_queue_lock(q);
 
 	ocs_dma_sync(&q->dma, OCS_DMASYNC_POSTREAD);
 
@@ -4990,7 +4990,7 @@ sli_queue_is_empty(sli4_t *sli4, sli4_queue_t *q)
 
 	rc = !sli_queue_entry_is_valid(q, qe, FALSE);
 
-	ocs_unlock(&q->lock);
+	_sli_queue_unlock(q);
 
 	return rc;
 }
@@ -5010,11 +5010,11 @@ sli_queue_eq_arm(sli4_t *sli4, sli4_queue_t *q, uint8_t arm)
 {
 	uint32_t	val = 0;
 
-	ocs_lock(&q->lock);
+	_sli_queue_lock(q);
 		val = sli_eq_doorbell(q->n_posted, q->id, arm);
 		ocs_reg_write32(sli4->os, q->doorbell_rset, q->doorbell_offset, val);
 		q->n_posted = 0;
-	ocs_unlock(&q->lock);
+	_sli_queue_unlock(q);
 
 	return 0;
 }
@@ -5034,7 +5034,7 @@ sli_queue_arm(sli4_t *sli4, sli4_queue_t *q, uint8_t arm)
 {
 	uint32_t	val = 0;
 
-	ocs_lock(&q->lock);
+	_sli_queue_lock(q);
 
 	switch (q->type) {
 	case SLI_QTYPE_EQ:
@@ -5052,7 +5052,7 @@ sli_queue_arm(sli4_t *sli4, sli4_queue_t *q, uint8_t arm)
 				__func__, SLI_QNAME[q->type]);
 	}
 
-	ocs_unlock(&q->lock);
+	_sli_queue_unlock(q);
 
 	return 0;
 }
@@ -5138,9 +5138,9 @@ sli_queue_write(sli4_t *sli4, sli4_queue_t *q, uint8_t *entry)
 {
 	int32_t rc;
 
-	ocs_lock(&q->lock);
+	sli_queue_lock(q);
 		rc = _sli_queue_write(sli4, q, entry);
-	ocs_unlock(&q->lock);
+	sli_queue_unlock(q);
 
 	return rc;
 }
@@ -5217,14 +5217,14 @@ sli_queue_read(sli4_t *sli4, sli4_queue_t *q, uint8_t *entry)
 		qindex = &q->index;
 	}
 
-	ocs_lock(&q->lock);
+	sli_queue_lock(q);
 
 	ocs_dma_sync(&q->dma, OCS_DMASYNC_POSTREAD);
 
 	qe += *qindex * q->size;
 
 	if (!sli_queue_entry_is_valid(q, qe, TRUE)) {
-		ocs_unlock(&q->lock);
+		sli_queue_unlock(q);
 		return -1;
 	}
 
@@ -5261,7 +5261,7 @@ sli_queue_read(sli4_t *sli4, sli4_queue_t *q, uint8_t *entry)
 			break;
 	}
 
-	ocs_unlock(&q->lock);
+	sli_queue_unlock(q);
 
 	return rc;
 }
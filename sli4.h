@@ -3060,6 +3060,8 @@ typedef struct sli4_queue_s {
 	uint32_t	posted_limit;	/** number of CQE/EQE to process before ringing doorbell */
 	uint32_t	max_num_processed;
 	time_t		max_process_time;
+	uint8_t		single_owner;	/** one thread reads (EQ/CQ) or writes (WQ), lock not taken */
+	uint32_t	owner_tid;	/** debug: thread that owns a single_owner queue */
 
 	/* Type specific gunk */
 	union {
@@ -3072,16 +3074,71 @@ typedef struct sli4_queue_s {
 	} u;
 } sli4_queue_t;
 
+/*
+ * Queues marked single_owner are only ever read (EQ/CQ) or written (WQ) by
+ * one thread, so q->lock is skipped. Debug builds check that every access
+ * comes from the thread that made the first one.
+ */
+static inline void
+sli_queue_owner_check(sli4_queue_t *q)
+{
+#ifndef NDEBUG
+	uint32_t tid = ocs_mkpid().l;
+
+	if (!q->owner_tid) {
+		q->owner_tid = tid;
+	}
+	assert(q->owner_tid == tid);
+#endif
+}
+
+/* Let the next thread through take over a single_owner queue */
+static inline void
+sli_queue_release_owner(sli4_queue_t *q)
+{
+	q->owner_tid = 0;
+}
+
+static inline void
+sli_queue_set_single_owner(sli4_queue_t *q, uint8_t single_owner)
+{
+	q->single_owner = single_owner;
+	q->owner_tid = 0;
+}
+
+/* Lock without the owner check, for doorbell/arm paths also used at setup */
+static inline void
+_sli_queue_lock(sli4_queue_t *q)
+{
+	if (!q->single_owner) {
+		ocs_lock(&q->lock);
+	}
+}
+
+static inline void
+_sli_queue_unlock(sli4_queue_t *q)
+{
+	if (!q->single_owner) {
+		ocs_unlock(&q->lock);
+	}
+}
+
 static inline void
 sli_queue_lock(sli4_queue_t *q)
 {
+	if (q->single_owner) {
+		sli_queue_owner_check(q);
+		return;
+	}
 	ocs_lock(&q->lock);
 }
 
 static inline void
 sli_queue_unlock(sli4_queue_t *q)
 {
-	ocs_unlock(&q->lock);
+	if (!q->single_owner) {
+		ocs_unlock(&q->lock);
+	}
 }
 
 
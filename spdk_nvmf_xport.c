@@ -39,6 +39,7 @@
 #include "spdk/string.h"
 #include "spdk/util.h"
 #include "spdk/event.h"
+#include "spdk/io_channel.h"
 #include "spdk/likely.h"
 #include "spdk/trace.h"
 #include "spdk_internal/log.h"
@@ -62,6 +63,9 @@
 
 #define BCM_MAX_IOVECS (SPDK_NVMF_MAX_SGL_ENTRIES + 2) /* 2 for skips */
 
+/* Max iovecs checked for collapsing into a single BDE */
+#define BCM_CONTIG_IOVCNT_MAX 4
+
 #define BCM_CQE_CODE_OFFSET	14
 
 #define PTR_TO_ADDR32_HI(x)  (uint32_t)((uint64_t)(x & 0xFFFFFFFF00000000LL) >> 32);
@@ -1239,7 +1243,21 @@ struct nvmf_fc_srsr_bufs {
 	void *sgl_virt;
 	uint64_t sgl_phys;
 	uint32_t sgl_len;
-	char mz_name[24]; /* name of memzone buffer allocated */
+	void *buf_virt;   /* DMA buffer holding rqst, rsp and sgl */
+	uint64_t buf_phys;
+	bool from_slab;   /* buf is a g_nvmf_fc_srsr_slab slot */
+};
+
+/*
+ * Slab of reusable SRSR DMA buffers. Slots are aligned to their size so
+ * none crosses a 2MB page, and their physical addresses are computed once.
+ */
+#define SRSR_SLAB_BUF_SIZE  512
+#define SRSR_SLAB_BUF_COUNT 256
+struct nvmf_fc_srsr_slab {
+	void *virt;
+	struct nvmf_fc_srsr_bufs *bufs; /* descriptor per slot */
+	struct spdk_ring *free_ring;
 };
 
 /*
@@ -1320,16 +1338,178 @@ nvmf_fc_xri_list_cleanup(void)
 	}
 }
 
+static struct nvmf_fc_srsr_slab g_nvmf_fc_srsr_slab;
+
+static void
+nvmf_fc_srsr_slab_destroy(void)
+{
+	struct nvmf_fc_srsr_slab *slab = &g_nvmf_fc_srsr_slab;
+
+	if (slab->free_ring) {
+		spdk_ring_free(slab->free_ring);
+	}
+	if (slab->virt) {
+		spdk_dma_free(slab->virt);
+	}
+	free(slab->bufs);
+	memset(slab, 0, sizeof(struct nvmf_fc_srsr_slab));
+}
+
+static int
+nvmf_fc_srsr_slab_create(void)
+{
+	struct nvmf_fc_srsr_slab *slab = &g_nvmf_fc_srsr_slab;
+	struct nvmf_fc_srsr_bufs *b;
+	void *obj[1];
+	uint32_t i;
+
+	slab->bufs = calloc(SRSR_SLAB_BUF_COUNT, sizeof(struct nvmf_fc_srsr_bufs));
+	slab->virt = spdk_dma_zmalloc(SRSR_SLAB_BUF_COUNT * SRSR_SLAB_BUF_SIZE,
+				      SRSR_SLAB_BUF_SIZE, NULL);
+	slab->free_ring = spdk_ring_create(SPDK_RING_TYPE_MP_MC, 2 * SRSR_SLAB_BUF_COUNT,
+					   SPDK_ENV_SOCKET_ID_ANY);
+	if (!slab->bufs || !slab->virt || !slab->free_ring) {
+		SPDK_ERRLOG("Failed to create SRSR buffer slab\n");
+		goto error;
+	}
+
+	for (i = 0; i < SRSR_SLAB_BUF_COUNT; i++) {
+		b = &slab->bufs[i];
+		b->buf_virt = (uint8_t *)slab->virt + (i * SRSR_SLAB_BUF_SIZE);
+		b->buf_phys = spdk_vtophys(b->buf_virt, NULL);
+		b->from_slab = true;
+		if (b->buf_phys == SPDK_VTOPHYS_ERROR) {
+			SPDK_ERRLOG("Failed to translate SRSR buffer slab\n");
+			goto error;
+		}
+
+		obj[0] = b;
+		if (spdk_ring_enqueue(slab->free_ring, obj, 1, NULL) != 1) {
+			goto error;
+		}
+	}
+
+	return 0;
+error:
+	nvmf_fc_srsr_slab_destroy();
+	return -1;
+}
+
+/*
+ * Return cached XRIs above the given level to the port XRI ring.
+ */
+static void
+nvmf_fc_xri_cache_drain(struct bcm_nvmf_hw_queues *hwq, uint32_t level)
+{
+	struct fc_xri_cache *cache = &hwq->xri_cache;
+	uint32_t n;
+
+	if (cache->count <= level) {
+		return;
+	}
+
+	n = cache->count - level;
+	if (spdk_ring_enqueue(hwq->xri_list->xri_ring, (void **)&cache->xri[level], n, NULL) == n) {
+		cache->count = level;
+	}
+}
+
+/*
+ * Drain the whole cache once a peer hwqp has found the port ring empty.
+ */
+static inline void
+nvmf_fc_xri_cache_reclaim(struct bcm_nvmf_hw_queues *hwq)
+{
+	struct fc_xri_cache *cache = &hwq->xri_cache;
+	uint32_t gen = __atomic_load_n(&hwq->xri_list->reclaim_gen, __ATOMIC_RELAXED);
+
+	if (spdk_likely(cache->reclaim_gen == gen)) {
+		return;
+	}
+
+	cache->reclaim_gen = gen;
+	if (cache->count) {
+		nvmf_fc_xri_cache_drain(hwq, 0);
+		cache->reclaims++;
+	}
+}
+
+/*
+ * Per-hwqp state is owned by the hwqp poller thread. Settings changed from
+ * RPC or admin threads are applied there by message; directly if the hwqp
+ * has no thread yet or the caller already runs on it.
+ */
+typedef void (*nvmf_fc_hwqp_msg_fn)(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t arg0,
+				    uint32_t arg1);
+
+struct nvmf_fc_hwqp_msg {
+	struct spdk_nvmf_fc_hwqp *hwqp;
+	nvmf_fc_hwqp_msg_fn fn;
+	uint32_t arg0;
+	uint32_t arg1;
+};
+
+static void
+nvmf_fc_hwqp_msg_run(void *ctx)
+{
+	struct nvmf_fc_hwqp_msg *msg = ctx;
+
+	msg->fn(msg->hwqp, msg->arg0, msg->arg1);
+	free(msg);
+}
+
+static int
+nvmf_fc_hwqp_send_msg(struct spdk_nvmf_fc_hwqp *hwqp, nvmf_fc_hwqp_msg_fn fn,
+		      uint32_t arg0, uint32_t arg1)
+{
+	struct nvmf_fc_hwqp_msg *msg;
+
+	if (!hwqp->thread || hwqp->thread == spdk_get_thread()) {
+		fn(hwqp, arg0, arg1);
+		return 0;
+	}
+
+	msg = calloc(1, sizeof(*msg));
+	if (!msg) {
+		SPDK_ERRLOG("hwqp %d: message alloc failed\n", hwqp->hwqp_id);
+		return -ENOMEM;
+	}
+
+	msg->hwqp = hwqp;
+	msg->fn = fn;
+	msg->arg0 = arg0;
+	msg->arg1 = arg1;
+	spdk_thread_send_msg(hwqp->thread, nvmf_fc_hwqp_msg_run, msg);
+	return 0;
+}
+
+static void
+nvmf_fc_xri_cache_drain_msg(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t level, uint32_t unused)
+{
+	nvmf_fc_xri_cache_drain(BCM_HWQP(hwqp), level);
+}
+
+/*
+ * Queue sizes are powers of 2 (checked in nvmf_fc_init_rqpair_buffers),
+ * so indexes wrap with the precomputed mask.
+ */
 static inline void
 nvmf_fc_queue_tail_inc(bcm_sli_queue_t *q)
 {
-	q->tail = (q->tail + 1) % q->max_entries;
+	q->tail = (q->tail + 1) & q->mask;
 }
 
 static inline void
 nvmf_fc_queue_head_inc(bcm_sli_queue_t *q)
 {
-	q->head = (q->head + 1) % q->max_entries;
+	q->head = (q->head + 1) & q->mask;
+}
+
+static inline bool
+nvmf_fc_queue_size_valid(bcm_sli_queue_t *q)
+{
+	return q->max_entries && !(q->max_entries & (q->max_entries - 1)) &&
+	       (q->mask == (q->max_entries - 1));
 }
 
 static inline void *
@@ -1370,40 +1550,39 @@ nvmf_fc_rqpair_get_frame_buffer(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t rqindex
 	return BCM_HWQP(hwqp)->rq_payload.buffer + buf_index;
 }
 
+static inline void
+nvmf_fc_reqtag_push(struct fc_wrkq *wq, fc_reqtag_t *tag)
+{
+	tag->next = wq->reqtag_free;
+	wq->reqtag_free = tag;
+	wq->reqtag_free_cnt++;
+}
+
 static int
 nvmf_fc_create_reqtag_pool(struct spdk_nvmf_fc_hwqp *hwqp)
 {
 	int i;
 	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
 	fc_reqtag_t *obj;
-	static int unique_number = 0;
-
-	unique_number++;
-
-	/* Create reqtag ring of size MAX_REQTAG_POOL_SIZE + 1 and make sure its power of 2. */
-	wq->reqtag_ring = spdk_ring_create(SPDK_RING_TYPE_MP_SC, (MAX_REQTAG_POOL_SIZE + 1),
-					   SPDK_ENV_SOCKET_ID_ANY);
-	if (!wq->reqtag_ring) {
-		SPDK_ERRLOG("create fc reqtag ring failed\n");
-		return -1;
-	}
 
-	/* Create ring objects */
+	/* Create reqtag objects */
 	wq->reqtag_objs = calloc(MAX_REQTAG_POOL_SIZE, sizeof(fc_reqtag_t));
 	if (!wq->reqtag_objs) {
-		SPDK_ERRLOG("create fc reqtag ring objects failed\n");
-		goto error;
+		SPDK_ERRLOG("create fc reqtag objects failed\n");
+		return -1;
 	}
 
-	/* Initialise index value in ring objects and queue the objects to ring */
-	for (i = 0; i < MAX_REQTAG_POOL_SIZE; i ++) {
+	/*
+	 * Initialise index value in the objects and put them on the free list.
+	 * Push in reverse order so that low indexes are handed out first.
+	 */
+	wq->reqtag_free = NULL;
+	wq->reqtag_free_cnt = 0;
+	for (i = MAX_REQTAG_POOL_SIZE - 1; i >= 0; i--) {
 		obj = wq->reqtag_objs + i;
 
 		obj->index = i;
-		if (spdk_ring_enqueue(wq->reqtag_ring, (void **)&obj, 1, NULL) != 1) {
-			SPDK_ERRLOG("fc reqtag ring enqueue objects failed %d\n", i);
-			goto error;
-		}
+		nvmf_fc_reqtag_push(wq, obj);
 		wq->p_reqtags[i] = NULL;
 	}
 
@@ -1411,15 +1590,85 @@ nvmf_fc_create_reqtag_pool(struct spdk_nvmf_fc_hwqp *hwqp)
 	wq->wqec_count = 0;
 
 	return 0;
-error:
-	if (wq->reqtag_objs) {
-		free(wq->reqtag_objs);
+}
+
+/* Put every context of the pool back on its free list */
+static void
+nvmf_fc_caller_ctx_pool_reset(struct fc_caller_ctx_pool *pool)
+{
+	int i;
+
+	pool->free_cnt = 0;
+	for (i = MAX_CALLER_CTX_POOL_SIZE - 1; i >= 0; i--) {
+		pool->free[pool->free_cnt++] = pool->objs + i;
+	}
+}
+
+static int
+nvmf_fc_create_caller_ctx_pool(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	struct fc_caller_ctx_pool *pool = &BCM_HWQP(hwqp)->ctx_pool;
+
+	pool->objs = calloc(MAX_CALLER_CTX_POOL_SIZE, sizeof(struct spdk_nvmf_fc_caller_ctx));
+	if (!pool->objs) {
+		SPDK_ERRLOG("create fc caller ctx pool failed\n");
+		return -1;
 	}
 
-	if (wq->reqtag_ring) {
-		spdk_ring_free(wq->reqtag_ring);
+	nvmf_fc_caller_ctx_pool_reset(pool);
+	return 0;
+}
+
+static void
+nvmf_fc_free_caller_ctx_pool(struct bcm_nvmf_hw_queues *hwq)
+{
+	free(hwq->ctx_pool.objs);
+	hwq->ctx_pool.objs = NULL;
+	hwq->ctx_pool.free_cnt = 0;
+}
+
+static void
+nvmf_fc_free_reqtag_pool(struct bcm_nvmf_hw_queues *hwq)
+{
+	struct fc_wrkq *wq = &hwq->wq;
+
+	if (wq->sf_reqtag) {
+		wq->p_reqtags[wq->sf_reqtag->index] = NULL;
+		wq->sf_reqtag = NULL;
+	}
+
+	free(wq->reqtag_objs);
+	wq->reqtag_objs = NULL;
+	wq->reqtag_free = NULL;
+	wq->reqtag_free_cnt = 0;
+}
+
+static struct spdk_nvmf_fc_caller_ctx *
+nvmf_fc_caller_ctx_get(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	struct fc_caller_ctx_pool *pool = &BCM_HWQP(hwqp)->ctx_pool;
+	struct spdk_nvmf_fc_caller_ctx *ctx;
+
+	if (spdk_likely(pool->free_cnt)) {
+		ctx = pool->free[--pool->free_cnt];
+		memset(ctx, 0, sizeof(struct spdk_nvmf_fc_caller_ctx));
+		return ctx;
+	}
+
+	BCM_HWQP(hwqp)->stats.caller_ctx_pool_empty++;
+	return calloc(1, sizeof(struct spdk_nvmf_fc_caller_ctx));
+}
+
+static void
+nvmf_fc_caller_ctx_put(struct spdk_nvmf_fc_hwqp *hwqp, struct spdk_nvmf_fc_caller_ctx *ctx)
+{
+	struct fc_caller_ctx_pool *pool = &BCM_HWQP(hwqp)->ctx_pool;
+
+	if (ctx >= pool->objs && ctx < (pool->objs + MAX_CALLER_CTX_POOL_SIZE)) {
+		pool->free[pool->free_cnt++] = ctx;
+	} else {
+		free(ctx);
 	}
-	return -1;
 }
 
 static fc_reqtag_t *
@@ -1428,9 +1677,14 @@ nvmf_fc_get_reqtag(struct spdk_nvmf_fc_hwqp *hwqp)
 	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
 	fc_reqtag_t *tag;
 
-	if (!spdk_ring_dequeue(wq->reqtag_ring, (void **)&tag, 1)) {
+	tag = wq->reqtag_free;
+	if (!tag) {
+		BCM_HWQP(hwqp)->io_cnt->reqtag_exhausted++;
 		return NULL;
 	}
+	wq->reqtag_free = tag->next;
+	wq->reqtag_free_cnt--;
+	tag->next = NULL;
 
 	/* Save the pointer for lookup */
 	wq->p_reqtags[tag->index] = tag;
@@ -1453,19 +1707,18 @@ static int
 nvmf_fc_release_reqtag(struct spdk_nvmf_fc_hwqp *hwqp, fc_reqtag_t *tag)
 {
 	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
-	int rc;
-
-	rc = spdk_ring_enqueue(wq->reqtag_ring, (void**)&tag, 1, NULL);
 
-	if (rc == 1) {
-		wq->p_reqtags[tag->index] = NULL;
-		tag->cb = NULL;
-		tag->cb_args = NULL;
+	if (wq->p_reqtags[tag->index] != tag) {
+		/* Not outstanding, already on the free list */
+		return -1;
 	}
-	// Driver & library interpretation of return code is different
-	rc ^= 1;
 
-	return rc;
+	wq->p_reqtags[tag->index] = NULL;
+	tag->cb = NULL;
+	tag->cb_args = NULL;
+	nvmf_fc_reqtag_push(wq, tag);
+
+	return 0;
 }
 
 static void
@@ -1509,68 +1762,43 @@ nvmf_fc_bcm_notify_queue(bcm_sli_queue_t *q, bool arm_queue, uint16_t num_entrie
 	reg->doorbell = entry.doorbell;
 }
 
-static uint8_t
-nvmf_fc_queue_entry_is_valid(bcm_sli_queue_t *q, uint8_t *qe, uint8_t clear)
+/*
+ * EQ/CQ consumers. Entries are parsed in place in the queue memory;
+ * peek returns the tail entry if it is valid and consume clears the
+ * valid bit and advances the tail once the caller is done with it.
+ */
+static inline eqe_t *
+nvmf_fc_eq_peek(bcm_sli_queue_t *q)
 {
-	uint8_t valid = 0;
-
-	switch (q->type) {
-	case BCM_FC_QUEUE_TYPE_EQ:
-		valid = ((eqe_t *)qe)->valid;
-		if (valid & clear) {
-			((eqe_t *)qe)->valid = 0;
-		}
-		break;
-	case BCM_FC_QUEUE_TYPE_CQ_WQ:
-	case BCM_FC_QUEUE_TYPE_CQ_RQ:
-		/*
-		 * For both WCQE and RCQE, the valid bit
-		 * is bit 31 of dword 3 (0 based)
-		 */
-		valid = (qe[15] & 0x80) != 0;
-		if (valid & clear) {
-			qe[15] &= ~0x80;
-		}
-		break;
-	default:
-		SPDK_ERRLOG("%s doesn't handle type=%#x\n", __func__, q->type);
-	}
+	eqe_t *eqe = nvmf_fc_queue_tail_node(q);
 
-	return valid;
+	return eqe->valid ? eqe : NULL;
 }
 
-static int
-nvmf_fc_read_queue_entry(bcm_sli_queue_t *q, uint8_t *entry)
+static inline void
+nvmf_fc_eq_consume(bcm_sli_queue_t *q, eqe_t *eqe)
 {
-	uint8_t	*qe;
-
-	switch (q->type) {
-	case BCM_FC_QUEUE_TYPE_EQ:
-	case BCM_FC_QUEUE_TYPE_CQ_WQ:
-	case BCM_FC_QUEUE_TYPE_CQ_RQ:
-		break;
-	default:
-		SPDK_ERRLOG("%s read not handled for queue type=%#x\n",
-			    __func__, q->type);
-		return -1;
-	}
-
-	/* Get the tail entry */
-	qe = nvmf_fc_queue_tail_node(q);
+	eqe->valid = 0;
+	nvmf_fc_queue_tail_inc(q);
+}
 
-	/* Check if entry is valid */
-	if (!nvmf_fc_queue_entry_is_valid(q, qe, true)) {
-		return -1;
-	}
+static inline uint8_t *
+nvmf_fc_cq_peek(bcm_sli_queue_t *q)
+{
+	uint8_t *cqe = nvmf_fc_queue_tail_node(q);
 
-	/* Make a copy if user requests */
-	if (entry) {
-		memcpy(entry, qe, q->size);
-	}
+	/*
+	 * For both WCQE and RCQE, the valid bit
+	 * is bit 31 of dword 3 (0 based)
+	 */
+	return (cqe[15] & 0x80) ? cqe : NULL;
+}
 
+static inline void
+nvmf_fc_cq_consume(bcm_sli_queue_t *q, uint8_t *cqe)
+{
+	cqe[15] &= ~0x80;
 	nvmf_fc_queue_tail_inc(q);
-
-	return 0;
 }
 
 static int
@@ -1610,73 +1838,149 @@ nvmf_fc_write_queue_entry(bcm_sli_queue_t *q, uint8_t *entry)
 	return 0;
 }
 
-static int
-nvmf_fc_post_wqe(struct spdk_nvmf_fc_hwqp *hwqp, uint8_t *entry, bool notify,
-		 bcm_fc_wqe_cb cb, void *cb_args)
+/*
+ * Ring the WQ doorbell once for all the WQEs posted since the last flush.
+ */
+static void
+nvmf_fc_flush_wq(struct spdk_nvmf_fc_hwqp *hwqp)
 {
-	int rc = -1;
-	bcm_generic_wqe_t *wqe = (bcm_generic_wqe_t *)entry;
 	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
-	fc_reqtag_t *reqtag = NULL;
 
-	if (!entry || !cb) {
-		goto error;
+	if (!wq->num_pending) {
+		return;
 	}
 
+	nvmf_fc_bcm_notify_queue(&wq->q, false, wq->num_pending);
+
+	BCM_HWQP(hwqp)->stats.wq_doorbells++;
+	BCM_HWQP(hwqp)->stats.wq_doorbells_saved += (wq->num_pending - 1);
+	wq->num_pending = 0;
+}
+
+/*
+ * Reserve the next WQ slot so a WQE can be built directly in ring memory.
+ * The slot is initialized from tmpl, or zeroed if tmpl is NULL. Nothing is
+ * consumed until nvmf_fc_wqe_commit(), so a caller that fails while
+ * building the WQE can simply drop the slot.
+ */
+static uint8_t *
+nvmf_fc_wqe_reserve(struct spdk_nvmf_fc_hwqp *hwqp, const uint8_t *tmpl)
+{
+	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
+	uint8_t *qe;
+
 	/* Make sure queue is online */
 	if (hwqp->state != SPDK_FC_HWQP_ONLINE) {
-		/*
-		SPDK_ERRLOG("%s queue is not online. WQE not posted. hwqp_id = %d type = %#x\n",
-			    __func__, hwqp->hwqp_id, wq->q.type);
-		 */
-		goto error;
+		return NULL;
 	}
 
 	/* Make sure queue is not full */
 	if (nvmf_fc_queue_full(&wq->q)) {
 		SPDK_ERRLOG("%s queue full. type = %#x\n", __func__, wq->q.type);
-		goto error;
+		hwqp->counters.wqe_write_err++;
+		return NULL;
 	}
 
-	/* Alloc a reqtag */
-	reqtag = nvmf_fc_get_reqtag(hwqp);
-	if (!reqtag) {
-		SPDK_ERRLOG("%s No reqtag available\n", __func__);
-		goto error;
+	qe = nvmf_fc_queue_head_node(&wq->q);
+	if (tmpl) {
+		memcpy(qe, tmpl, wq->q.size);
+	} else {
+		memset(qe, 0, wq->q.size);
 	}
-	reqtag->cb = cb;
-	reqtag->cb_args = cb_args;
+
+	return qe;
+}
+
+static uint32_t
+nvmf_fc_default_wqec_cnt(struct fc_wrkq *wq)
+{
+	return spdk_max(BCM_WQEC_CNT_MIN,
+			spdk_min(BCM_WQEC_CNT_MAX, wq->q.max_entries / BCM_WQEC_DEPTH_DIV));
+}
+
+/*
+ * Submit a WQE built in the slot returned by nvmf_fc_wqe_reserve() under
+ * the given request tag: set the WQEC bit when due and advance the WQ head.
+ */
+static void
+nvmf_fc_wqe_submit(struct spdk_nvmf_fc_hwqp *hwqp, uint8_t *entry, bool notify,
+		   uint16_t request_tag)
+{
+	bcm_generic_wqe_t *wqe = (bcm_generic_wqe_t *)entry;
+	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
+
+	assert(entry == nvmf_fc_queue_head_node(&wq->q));
 
 	/* Update request tag in the WQE entry */
-	wqe->request_tag = reqtag->index;
+	wqe->request_tag = request_tag;
 	wq->wqec_count ++;
 
-	if (wq->wqec_count == MAX_WQ_WQEC_CNT) {
+	if (wq->wqec_count >= wq->wqec_cnt ||
+	    (wq->q.max_entries - wq->q.used) <= 2 * wq->wqec_cnt) {
 		wqe->wqec = 1;
-	}
-
-	rc = nvmf_fc_write_queue_entry(&wq->q, entry);
-	if (rc) {
-		SPDK_ERRLOG("%s: WQE write failed. \n", __func__);
-		hwqp->counters.wqe_write_err++;
-		goto error;
-	}
-
-	wq->q.used++;
-	if (wqe->wqec) {
 		/* Reset wqec count. */
 		wq->wqec_count = 0;
 	}
 
+	nvmf_fc_queue_head_inc(&wq->q);
+	wq->q.used++;
+	BCM_HWQP(hwqp)->io_cnt->wqes_posted++;
+
 	if (notify) {
-		nvmf_fc_bcm_notify_queue(&wq->q, false, 1);
-	}
-	return 0;
-error:
-	if (reqtag) {
-		nvmf_fc_release_reqtag(hwqp, reqtag);
+		/*
+		 * In batch mode the doorbell is rung at the end of the poll
+		 * (or once enough WQEs are pending) instead of per WQE.
+		 */
+		wq->num_pending++;
+		if (!wq->db_batch || wq->num_pending >= MAX_WQ_DB_BATCH_CNT) {
+			nvmf_fc_flush_wq(hwqp);
+		}
 	}
-	return rc;
+}
+
+/*
+ * Commit a WQE built in the slot returned by nvmf_fc_wqe_reserve() with a
+ * reqtag of its own, so cb is called when the WQE completes.
+ */
+static int
+nvmf_fc_wqe_commit(struct spdk_nvmf_fc_hwqp *hwqp, uint8_t *entry, bool notify,
+		   bcm_fc_wqe_cb cb, void *cb_args)
+{
+	fc_reqtag_t *reqtag = NULL;
+
+	if (!cb) {
+		return -1;
+	}
+
+	/* Alloc a reqtag */
+	reqtag = nvmf_fc_get_reqtag(hwqp);
+	if (!reqtag) {
+		SPDK_ERRLOG("%s No reqtag available\n", __func__);
+		return -1;
+	}
+	reqtag->cb = cb;
+	reqtag->cb_args = cb_args;
+
+	nvmf_fc_wqe_submit(hwqp, entry, notify, reqtag->index);
+	return 0;
+}
+
+static int
+nvmf_fc_post_wqe(struct spdk_nvmf_fc_hwqp *hwqp, uint8_t *entry, bool notify,
+		 bcm_fc_wqe_cb cb, void *cb_args)
+{
+	uint8_t *qe;
+
+	if (!entry || !cb) {
+		return -1;
+	}
+
+	qe = nvmf_fc_wqe_reserve(hwqp, entry);
+	if (!qe) {
+		return -1;
+	}
+
+	return nvmf_fc_wqe_commit(hwqp, qe, notify, cb, cb_args);
 }
 
 static int
@@ -1931,9 +2235,31 @@ nvmf_fc_rqpair_buffer_post(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t idx, bool no
 	return rc;
 }
 
+/*
+ * Ring the RQ doorbell once for all the buffers reposted since the last flush.
+ */
+static void
+nvmf_fc_flush_rq(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	struct fc_rcvq *hdr = &BCM_HWQP(hwqp)->rq_hdr;
+
+	if (!hdr->num_pending) {
+		return;
+	}
+
+	nvmf_fc_bcm_notify_queue(&hdr->q, false, hdr->num_pending);
+
+	BCM_HWQP(hwqp)->stats.rq_doorbells++;
+	BCM_HWQP(hwqp)->stats.rq_doorbells_saved += (hdr->num_pending - 1);
+	hdr->num_posted += hdr->num_pending;
+	hdr->num_pending = 0;
+}
+
 static void
 nvmf_fc_rqpair_buffer_release(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t buff_idx)
 {
+	struct fc_rcvq *hdr = &BCM_HWQP(hwqp)->rq_hdr;
+
 	/* Decrement used */
 	BCM_HWQP(hwqp)->rq_hdr.q.used--;
 	BCM_HWQP(hwqp)->rq_payload.q.used--;
@@ -1945,13 +2271,395 @@ nvmf_fc_rqpair_buffer_release(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t buff_idx)
 	/* Repost the freebuffer to head of queue. */
 	BCM_HWQP(hwqp)->rq_hdr.rq_map[
 		BCM_HWQP(hwqp)->rq_hdr.q.head] = buff_idx;
-	nvmf_fc_rqpair_buffer_post(hwqp, buff_idx, true);
+	if (nvmf_fc_rqpair_buffer_post(hwqp, buff_idx, false)) {
+		return;
+	}
+
+	/*
+	 * Defer the doorbell until the batch fills up or the poll ends, but
+	 * notify right away once the buffers visible to the adapter drop
+	 * below a quarter of the RQ so a burst can't starve it.
+	 */
+	hdr->num_pending++;
+	if (hdr->num_pending >= hdr->repost_batch ||
+	    hdr->num_posted < (hdr->q.max_entries / 4)) {
+		nvmf_fc_flush_rq(hwqp);
+	}
+}
+
+static bool g_nvmf_fc_lat_enabled;
+
+static const char *g_nvmf_fc_lat_phase_names[BCM_LAT_MAX_PHASE] = {
+	[BCM_LAT_RX_TO_WQE] = "rx_to_wqe",
+	[BCM_LAT_DATA] = "data",
+	[BCM_LAT_RSP] = "rsp",
+	[BCM_LAT_TOTAL] = "total",
+};
+
+void
+spdk_nvmf_fc_lat_hist_enable(bool enable)
+{
+	g_nvmf_fc_lat_enabled = enable;
+}
+
+bool
+spdk_nvmf_fc_lat_hist_enabled(void)
+{
+	return g_nvmf_fc_lat_enabled;
+}
+
+const char *
+spdk_nvmf_fc_lat_phase_name(uint32_t phase)
+{
+	return phase < BCM_LAT_MAX_PHASE ? g_nvmf_fc_lat_phase_names[phase] : NULL;
+}
+
+static inline uint32_t
+nvmf_fc_lat_bucket(uint64_t ticks)
+{
+	uint32_t msb;
+
+	if (ticks < (1 << BCM_LAT_HIST_SUB_BITS)) {
+		return ticks;
+	}
+
+	msb = 63 - __builtin_clzll(ticks);
+	return ((msb - BCM_LAT_HIST_SUB_BITS + 1) << BCM_LAT_HIST_SUB_BITS) |
+	       ((ticks >> (msb - BCM_LAT_HIST_SUB_BITS)) & ((1 << BCM_LAT_HIST_SUB_BITS) - 1));
+}
+
+/*
+ * Lowest tick value that lands in the given bucket.
+ */
+uint64_t
+spdk_nvmf_fc_lat_bucket_start(uint32_t bucket)
+{
+	uint32_t shift = bucket >> BCM_LAT_HIST_SUB_BITS;
+
+	if (!shift) {
+		return bucket;
+	}
+
+	return ((uint64_t)((1 << BCM_LAT_HIST_SUB_BITS) |
+			   (bucket & ((1 << BCM_LAT_HIST_SUB_BITS) - 1)))) << (shift - 1);
+}
+
+static inline void
+nvmf_fc_lat_record(struct fc_lat_stats *lat, uint32_t phase, uint64_t ticks)
+{
+	struct fc_lat_hist *hist = &lat->hist[phase];
+
+	hist->count++;
+	hist->sum_ticks += ticks;
+	hist->bucket[nvmf_fc_lat_bucket(ticks)]++;
+}
+
+static inline struct fc_io_ts *
+nvmf_fc_lat_ts(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t buff_idx)
+{
+	struct fc_lat_stats *lat = BCM_HWQP(hwqp)->lat;
+
+	if (spdk_likely(!g_nvmf_fc_lat_enabled) || !lat) {
+		return NULL;
+	}
+
+	return &lat->ts[buff_idx];
+}
+
+/* Command frame received */
+static inline void
+nvmf_fc_lat_rx(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t buff_idx)
+{
+	struct fc_io_ts *ts = nvmf_fc_lat_ts(hwqp, buff_idx);
+
+	if (ts) {
+		ts->rx = spdk_get_ticks();
+		ts->data = 0;
+		ts->rsp = 0;
+	}
+}
+
+/* TSEND/TRECEIVE posted */
+static inline void
+nvmf_fc_lat_data(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct fc_io_ts *ts = nvmf_fc_lat_ts(fc_req->hwqp, fc_req->buf_index);
+
+	if (!ts || !ts->rx || ts->data) {
+		return;
+	}
+
+	ts->data = spdk_get_ticks();
+	nvmf_fc_lat_record(BCM_HWQP(fc_req->hwqp)->lat, BCM_LAT_RX_TO_WQE, ts->data - ts->rx);
+}
+
+/* TRSP or response frame posted */
+static inline void
+nvmf_fc_lat_rsp(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct fc_io_ts *ts = nvmf_fc_lat_ts(fc_req->hwqp, fc_req->buf_index);
+
+	if (!ts || !ts->rx) {
+		return;
+	}
+
+	ts->rsp = spdk_get_ticks();
+	if (ts->data) {
+		nvmf_fc_lat_record(BCM_HWQP(fc_req->hwqp)->lat, BCM_LAT_DATA, ts->rsp - ts->data);
+	} else {
+		nvmf_fc_lat_record(BCM_HWQP(fc_req->hwqp)->lat, BCM_LAT_RX_TO_WQE, ts->rsp - ts->rx);
+	}
+}
+
+/* Exchange completed successfully */
+static inline void
+nvmf_fc_lat_done(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct fc_io_ts *ts = nvmf_fc_lat_ts(fc_req->hwqp, fc_req->buf_index);
+	struct fc_lat_stats *lat;
+	uint64_t now;
+
+	if (!ts || !ts->rx) {
+		return;
+	}
+
+	lat = BCM_HWQP(fc_req->hwqp)->lat;
+	now = spdk_get_ticks();
+	if (ts->rsp) {
+		nvmf_fc_lat_record(lat, BCM_LAT_RSP, now - ts->rsp);
+	} else if (ts->data) {
+		/* Auto-response TSEND */
+		nvmf_fc_lat_record(lat, BCM_LAT_DATA, now - ts->data);
+	}
+	nvmf_fc_lat_record(lat, BCM_LAT_TOTAL, now - ts->rx);
+	ts->rx = 0;
+}
+
+/*
+ * Connection counter slots are indexed by the per-hwqp connection number
+ * that nvmf_fc_gen_conn_id() folds into the connection ID.
+ */
+static inline uint32_t
+nvmf_fc_conn_counters_slot(struct spdk_nvmf_fc_hwqp *hwqp, uint64_t conn_id)
+{
+	return (conn_id / hwqp->fc_port->num_io_queues) & (BCM_MAX_CONN_COUNTERS - 1);
+}
+
+static struct fc_conn_counters *
+nvmf_fc_conn_counters(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct spdk_nvmf_fc_conn *fc_conn = spdk_nvmf_fc_get_conn(fc_req->req.qpair);
+	struct fc_io_counters *cnt = BCM_HWQP(fc_req->hwqp)->io_cnt;
+	uint32_t slot, i;
+
+	slot = nvmf_fc_conn_counters_slot(fc_req->hwqp, fc_conn->conn_id);
+	for (i = 0; i < BCM_MAX_CONN_COUNTERS; i++) {
+		if (cnt->conn[slot].conn_id == fc_conn->conn_id) {
+			return &cnt->conn[slot];
+		}
+		slot = (slot + 1) & (BCM_MAX_CONN_COUNTERS - 1);
+	}
+
+	/* More connections than slots */
+	return NULL;
+}
+
+static void
+nvmf_fc_conn_counters_add(struct spdk_nvmf_fc_hwqp *hwqp, uint64_t conn_id)
+{
+	struct fc_io_counters *cnt = BCM_HWQP(hwqp)->io_cnt;
+	uint32_t slot, i;
+
+	slot = nvmf_fc_conn_counters_slot(hwqp, conn_id);
+	for (i = 0; i < BCM_MAX_CONN_COUNTERS; i++) {
+		if (!cnt->conn[slot].conn_id) {
+			cnt->conn[slot].cmds = 0;
+			cnt->conn[slot].read_bytes = 0;
+			cnt->conn[slot].write_bytes = 0;
+			cnt->conn[slot].conn_id = conn_id;
+			return;
+		}
+		slot = (slot + 1) & (BCM_MAX_CONN_COUNTERS - 1);
+	}
+}
+
+static void
+nvmf_fc_conn_counters_del(struct spdk_nvmf_fc_hwqp *hwqp, uint64_t conn_id)
+{
+	struct fc_io_counters *cnt = BCM_HWQP(hwqp)->io_cnt;
+	uint32_t slot, i;
+
+	slot = nvmf_fc_conn_counters_slot(hwqp, conn_id);
+	for (i = 0; i < BCM_MAX_CONN_COUNTERS; i++) {
+		if (cnt->conn[slot].conn_id == conn_id) {
+			cnt->conn[slot].conn_id = 0;
+			return;
+		}
+		slot = (slot + 1) & (BCM_MAX_CONN_COUNTERS - 1);
+	}
+}
+
+static inline void
+nvmf_fc_count_read(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct fc_io_counters *cnt = BCM_HWQP(fc_req->hwqp)->io_cnt;
+	struct fc_conn_counters *conn = nvmf_fc_conn_counters(fc_req);
+
+	cnt->read_ios++;
+	cnt->read_bytes += fc_req->req.length;
+	if (conn) {
+		conn->read_bytes += fc_req->req.length;
+	}
+}
+
+static inline void
+nvmf_fc_count_write(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct fc_io_counters *cnt = BCM_HWQP(fc_req->hwqp)->io_cnt;
+	struct fc_conn_counters *conn = nvmf_fc_conn_counters(fc_req);
+
+	cnt->write_ios++;
+	cnt->write_bytes += fc_req->req.length;
+	if (conn) {
+		conn->write_bytes += fc_req->req.length;
+	}
 }
 
+static inline void
+nvmf_fc_count_done(struct spdk_nvmf_fc_request *fc_req)
+{
+	struct fc_conn_counters *conn = nvmf_fc_conn_counters(fc_req);
+
+	if (conn) {
+		conn->cmds++;
+	}
+}
+
+/*
+ * hwqps set up by this driver, for the RPCs. hwqp_id restarts at 0 on every
+ * port, so entries are keyed by port handle and hwqp_id.
+ */
+struct nvmf_fc_hwqp_entry {
+	struct spdk_nvmf_fc_hwqp *hwqp;
+	struct bcm_nvmf_hw_queues *queues;
+	uint8_t port_hdl;
+};
+
+static struct nvmf_fc_hwqp_entry g_nvmf_fc_hwqps[BCM_MAX_HWQPS];
+static uint32_t g_nvmf_fc_hwqp_count;
+
+static void
+nvmf_fc_register_hwqp(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	struct nvmf_fc_hwqp_entry *entry;
+	uint8_t port_hdl = hwqp->fc_port ? hwqp->fc_port->port_hdl : 0;
+	uint32_t i;
+
+	for (i = 0; i < g_nvmf_fc_hwqp_count; i++) {
+		entry = &g_nvmf_fc_hwqps[i];
+		if (entry->hwqp == hwqp ||
+		    (entry->port_hdl == port_hdl && entry->hwqp->hwqp_id == hwqp->hwqp_id)) {
+			break;
+		}
+	}
+
+	if (i == BCM_MAX_HWQPS) {
+		SPDK_ERRLOG("hwqp table full, port %d hwqp %d not registered\n",
+			    port_hdl, hwqp->hwqp_id);
+		return;
+	}
+
+	if (i == g_nvmf_fc_hwqp_count) {
+		g_nvmf_fc_hwqp_count++;
+	}
+
+	entry = &g_nvmf_fc_hwqps[i];
+	entry->hwqp = hwqp;
+	entry->queues = BCM_HWQP(hwqp);
+	entry->port_hdl = port_hdl;
+}
+
+static void
+nvmf_fc_unregister_hwqp(struct bcm_nvmf_hw_queues *hwq)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_nvmf_fc_hwqp_count; i++) {
+		if (g_nvmf_fc_hwqps[i].queues == hwq) {
+			g_nvmf_fc_hwqps[i] = g_nvmf_fc_hwqps[--g_nvmf_fc_hwqp_count];
+			memset(&g_nvmf_fc_hwqps[g_nvmf_fc_hwqp_count], 0,
+			       sizeof(struct nvmf_fc_hwqp_entry));
+			return;
+		}
+	}
+}
+
+uint32_t
+spdk_nvmf_fc_get_hwqp_count(void)
+{
+	return g_nvmf_fc_hwqp_count;
+}
+
+struct spdk_nvmf_fc_hwqp *
+spdk_nvmf_fc_get_hwqp(uint32_t index)
+{
+	return index < g_nvmf_fc_hwqp_count ? g_nvmf_fc_hwqps[index].hwqp : NULL;
+}
+
+uint8_t
+spdk_nvmf_fc_get_hwqp_port(uint32_t index)
+{
+	return index < g_nvmf_fc_hwqp_count ? g_nvmf_fc_hwqps[index].port_hdl : 0;
+}
+
+/*
+ * The per-hwqp vtophys caches are invalidated by bumping this generation
+ * whenever memory is unregistered; a poller that sees a new generation
+ * empties its cache before the next lookup.
+ */
+static struct spdk_mem_map *g_nvmf_fc_vtophys_map;
+static uint32_t g_nvmf_fc_vtophys_gen = 1;
+
+static int
+nvmf_fc_vtophys_notify(void *cb_ctx, struct spdk_mem_map *map,
+		       enum spdk_mem_map_notify_action action,
+		       void *vaddr, size_t size)
+{
+	if (action == SPDK_MEM_MAP_NOTIFY_UNREGISTER) {
+		__atomic_add_fetch(&g_nvmf_fc_vtophys_gen, 1, __ATOMIC_RELEASE);
+	}
+
+	return 0;
+}
+
+static const struct spdk_mem_map_ops g_nvmf_fc_vtophys_map_ops = {
+	.notify_cb = nvmf_fc_vtophys_notify,
+	.are_contiguous = NULL,
+};
+
 static int
 nvmf_fc_lld_init(void) 
 {
-	return spdk_fc_subsystem_init();
+	int rc;
+
+	g_nvmf_fc_vtophys_map = spdk_mem_map_alloc(0, &g_nvmf_fc_vtophys_map_ops, NULL);
+	if (!g_nvmf_fc_vtophys_map) {
+		SPDK_ERRLOG("Failed to register vtophys cache memory notifier\n");
+		return -1;
+	}
+
+	if (nvmf_fc_srsr_slab_create()) {
+		spdk_mem_map_free(&g_nvmf_fc_vtophys_map);
+		return -1;
+	}
+
+	rc = spdk_fc_subsystem_init();
+	if (rc) {
+		nvmf_fc_srsr_slab_destroy();
+		spdk_mem_map_free(&g_nvmf_fc_vtophys_map);
+	}
+
+	return rc;
 }
 
 static void 
@@ -1959,6 +2667,8 @@ nvmf_fc_lld_fini(void)
 {
 	spdk_fc_subsystem_fini();
 	nvmf_fc_xri_list_cleanup();
+	nvmf_fc_srsr_slab_destroy();
+	spdk_mem_map_free(&g_nvmf_fc_vtophys_map);
 }
 
 static void
@@ -1970,7 +2680,71 @@ nvmf_fc_lld_start(void)
 static int
 nvmf_fc_init_q(struct spdk_nvmf_fc_hwqp *hwqp)
 {
-	return nvmf_fc_create_reqtag_pool(hwqp);
+	struct bcm_nvmf_hw_queues *hwq = BCM_HWQP(hwqp);
+	bool lat_alloced = false;
+
+	if (nvmf_fc_create_reqtag_pool(hwqp)) {
+		return -1;
+	}
+
+	/* Reserve the reqtag shared by send-frame WQEs */
+	hwq->wq.sf_reqtag = BCM_SENDFRAME_SHARED_REQTAG ? nvmf_fc_get_reqtag(hwqp) : NULL;
+
+	if (nvmf_fc_create_caller_ctx_pool(hwqp)) {
+		goto err_reqtag;
+	}
+
+	if (!hwq->lat) {
+		hwq->lat = calloc(1, sizeof(struct fc_lat_stats));
+		if (!hwq->lat) {
+			SPDK_ERRLOG("%s: latency stats alloc failed\n", __func__);
+			goto err_ctx_pool;
+		}
+		lat_alloced = true;
+	}
+
+	if (!hwq->io_cnt) {
+		if (posix_memalign((void **)&hwq->io_cnt, SPDK_CACHE_LINE_SIZE,
+				   sizeof(struct fc_io_counters))) {
+			hwq->io_cnt = NULL;
+			SPDK_ERRLOG("%s: io counters alloc failed\n", __func__);
+			goto err_lat;
+		}
+		memset(hwq->io_cnt, 0, sizeof(struct fc_io_counters));
+		hwq->io_cnt->start_ticks = spdk_get_ticks();
+	}
+
+	nvmf_fc_register_hwqp(hwqp);
+	return 0;
+
+err_lat:
+	if (lat_alloced) {
+		free(hwq->lat);
+		hwq->lat = NULL;
+	}
+err_ctx_pool:
+	nvmf_fc_free_caller_ctx_pool(hwq);
+err_reqtag:
+	nvmf_fc_free_reqtag_pool(hwq);
+	return -1;
+}
+
+/*
+ * Undo nvmf_fc_init_q for queues the port teardown is about to free, so the
+ * RPCs no longer reach them.
+ */
+void
+spdk_nvmf_fc_fini_q(struct bcm_nvmf_hw_queues *hwq)
+{
+	nvmf_fc_unregister_hwqp(hwq);
+	nvmf_fc_free_reqtag_pool(hwq);
+	nvmf_fc_free_caller_ctx_pool(hwq);
+
+	free(hwq->lat);
+	hwq->lat = NULL;
+
+	free(hwq->io_cnt);
+	hwq->io_cnt = NULL;
 }
 
 static void
@@ -1983,13 +2757,37 @@ nvmf_fc_reinit_q(void *queues_prev, void *queues_curr)
 	wq_prev = &((struct bcm_nvmf_hw_queues *)queues_prev)->wq;
 	wq_curr = &((struct bcm_nvmf_hw_queues *)queues_curr)->wq;
 
+	/* Return XRIs cached by the previous queues to the port */
+	nvmf_fc_xri_cache_drain((struct bcm_nvmf_hw_queues *)queues_prev, 0);
+
  	/* Copy over reqtag pool information from previous wq queues. */
-	wq_curr->reqtag_ring = wq_prev->reqtag_ring;
+	wq_curr->reqtag_free = wq_prev->reqtag_free;
+	wq_curr->reqtag_free_cnt = wq_prev->reqtag_free_cnt;
 	wq_curr->reqtag_objs = wq_prev->reqtag_objs;
 
+	/*
+	 * Outstanding WQE callbacks are dropped below, so no caller context
+	 * stays in use; hand the pool over with all of them free.
+	 */
+	((struct bcm_nvmf_hw_queues *)queues_curr)->ctx_pool.objs =
+		((struct bcm_nvmf_hw_queues *)queues_prev)->ctx_pool.objs;
+	nvmf_fc_caller_ctx_pool_reset(&((struct bcm_nvmf_hw_queues *)queues_curr)->ctx_pool);
+
+	((struct bcm_nvmf_hw_queues *)queues_curr)->io_cnt =
+		((struct bcm_nvmf_hw_queues *)queues_prev)->io_cnt;
+
+	/* Latency histograms carry over; in flight timestamps are stale */
+	((struct bcm_nvmf_hw_queues *)queues_curr)->lat =
+		((struct bcm_nvmf_hw_queues *)queues_prev)->lat;
+	if (((struct bcm_nvmf_hw_queues *)queues_curr)->lat) {
+		memset(((struct bcm_nvmf_hw_queues *)queues_curr)->lat->ts, 0,
+		       sizeof(((struct bcm_nvmf_hw_queues *)queues_curr)->lat->ts));
+	}
+
 	wq_curr->wqec_count = 0;
 	for (i = 0; i < MAX_REQTAG_POOL_SIZE; i++) {
-		if (wq_prev->p_reqtags[i] != NULL) {
+		if (wq_prev->p_reqtags[i] != NULL &&
+		    wq_prev->p_reqtags[i] != wq_prev->sf_reqtag) {
 			/*
 			 * This condition is possible if we killed
 			 * commands that were in transfer state.
@@ -1997,17 +2795,90 @@ nvmf_fc_reinit_q(void *queues_prev, void *queues_curr)
 			wq_prev->p_reqtags[i]->cb = NULL;
 			wq_prev->p_reqtags[i]->cb_args = NULL;
 
-			(void)spdk_ring_enqueue(wq_curr->reqtag_ring, (void**) &wq_prev->p_reqtags[i], 1, NULL);
+			nvmf_fc_reqtag_push(wq_curr, wq_prev->p_reqtags[i]);
 			wq_prev->p_reqtags[i] = NULL;
 			count = count + 1;
 		}
 		wq_curr->p_reqtags[i] = NULL;
 	}
 
+	/* The shared send-frame reqtag stays reserved */
+	wq_curr->sf_reqtag = wq_prev->sf_reqtag;
+	if (wq_curr->sf_reqtag) {
+		wq_curr->p_reqtags[wq_curr->sf_reqtag->index] = wq_curr->sf_reqtag;
+	}
+
 	if (count) {
 		SPDK_DEBUGLOG(SPDK_LOG_NVMF_FC_LLD, "Found %d outstanding reqtags that were released\n",
 			      count);
 	}
+
+	/* The current queues own the allocations now; keep fini_q on prev a no-op */
+	wq_prev->reqtag_objs = NULL;
+	wq_prev->reqtag_free = NULL;
+	wq_prev->reqtag_free_cnt = 0;
+	wq_prev->sf_reqtag = NULL;
+	((struct bcm_nvmf_hw_queues *)queues_prev)->ctx_pool.objs = NULL;
+	((struct bcm_nvmf_hw_queues *)queues_prev)->ctx_pool.free_cnt = 0;
+	((struct bcm_nvmf_hw_queues *)queues_prev)->lat = NULL;
+	((struct bcm_nvmf_hw_queues *)queues_prev)->io_cnt = NULL;
+
+	for (i = 0; i < (int)g_nvmf_fc_hwqp_count; i++) {
+		if (g_nvmf_fc_hwqps[i].queues == queues_prev) {
+			g_nvmf_fc_hwqps[i].queues = queues_curr;
+		}
+	}
+}
+
+/*
+ * Fill in the per I/O invariant fields of the FCP WQE templates.
+ */
+static void
+nvmf_fc_init_wqe_templates(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	struct fc_wqe_templates *tmpl = &BCM_HWQP(hwqp)->wqe_tmpl;
+	bcm_fcp_tsend64_wqe_t *tsend = (bcm_fcp_tsend64_wqe_t *)tmpl->tsend;
+	bcm_fcp_treceive64_wqe_t *trecv = (bcm_fcp_treceive64_wqe_t *)tmpl->trecv;
+	bcm_fcp_trsp64_wqe_t *trsp = (bcm_fcp_trsp64_wqe_t *)tmpl->trsp;
+
+	SPDK_STATIC_ASSERT(sizeof(bcm_fcp_tsend64_wqe_t) <= BCM_WQE_TEMPLATE_BYTES &&
+			   sizeof(bcm_fcp_treceive64_wqe_t) <= BCM_WQE_TEMPLATE_BYTES &&
+			   sizeof(bcm_fcp_trsp64_wqe_t) <= BCM_WQE_TEMPLATE_BYTES,
+			   "WQE larger than template");
+
+	memset(tmpl, 0, sizeof(struct fc_wqe_templates));
+
+	tsend->xbl = true;
+	tsend->relative_offset = 0;
+	tsend->pu = true;
+	tsend->command = BCM_WQE_FCP_TSEND64;
+	tsend->class = BCM_ELS_REQUEST64_CLASS_3;
+	tsend->ct = BCM_ELS_REQUEST64_CONTEXT_RPI;
+	tsend->nvme = 1;
+	tsend->len_loc = 0x2;
+	tsend->cmd_type = BCM_CMD_FCP_TSEND64_WQE;
+	tsend->cq_id = 0xFFFF;
+
+	trecv->xbl = true;
+	trecv->relative_offset = 0;
+	trecv->pu = true;
+	trecv->ar = false;
+	trecv->command = BCM_WQE_FCP_TRECEIVE64;
+	trecv->class = BCM_ELS_REQUEST64_CLASS_3;
+	trecv->ct = BCM_ELS_REQUEST64_CONTEXT_RPI;
+	trecv->nvme 	= 1;
+	trecv->iod 	= 1;
+	trecv->len_loc 	= 0x2;
+	trecv->timer 	= 30;
+	trecv->cmd_type = BCM_CMD_FCP_TRECEIVE64_WQE;
+	trecv->cq_id = 0xFFFF;
+
+	trsp->command = BCM_WQE_FCP_TRSP64;
+	trsp->class = BCM_ELS_REQUEST64_CLASS_3;
+	trsp->len_loc = 0x1;
+	trsp->cq_id = 0xFFFF;
+	trsp->cmd_type = BCM_CMD_FCP_TRSP64_WQE;
+	trsp->nvme = 1;
 }
 
 static int
@@ -2019,19 +2890,48 @@ nvmf_fc_init_rqpair_buffers(struct spdk_nvmf_fc_hwqp *hwqp)
 	struct fc_rcvq *payload = &BCM_HWQP(hwqp)->rq_payload;
 
 	/* Init queue variables */
-	BCM_HWQP(hwqp)->eq.q.posted_limit = 16;
-	BCM_HWQP(hwqp)->cq_wq.q.posted_limit = 16;
-	BCM_HWQP(hwqp)->cq_rq.q.posted_limit = 16;
+	BCM_HWQP(hwqp)->eq.q.posted_limit = BCM_Q_POSTED_LIMIT;
+	BCM_HWQP(hwqp)->cq_wq.q.posted_limit = BCM_Q_POSTED_LIMIT;
+	BCM_HWQP(hwqp)->cq_rq.q.posted_limit = BCM_Q_POSTED_LIMIT;
+
+	BCM_HWQP(hwqp)->eq.q.processed_limit = BCM_Q_PROCESSED_LIMIT;
+	BCM_HWQP(hwqp)->cq_wq.q.processed_limit = BCM_Q_PROCESSED_LIMIT;
+	BCM_HWQP(hwqp)->cq_rq.q.processed_limit = BCM_Q_PROCESSED_LIMIT;
 
-	BCM_HWQP(hwqp)->eq.q.processed_limit = 64;
-	BCM_HWQP(hwqp)->cq_wq.q.processed_limit = 64;
-	BCM_HWQP(hwqp)->cq_rq.q.processed_limit = 64;
+	memset(&BCM_HWQP(hwqp)->eq.limit_ctl, 0, sizeof(struct fc_q_limit_ctl));
+	memset(&BCM_HWQP(hwqp)->cq_wq.limit_ctl, 0, sizeof(struct fc_q_limit_ctl));
+	memset(&BCM_HWQP(hwqp)->cq_rq.limit_ctl, 0, sizeof(struct fc_q_limit_ctl));
+	BCM_HWQP(hwqp)->eq.limit_ctl.enabled = true;
+	BCM_HWQP(hwqp)->cq_wq.limit_ctl.enabled = true;
+	BCM_HWQP(hwqp)->cq_rq.limit_ctl.enabled = true;
 
 	BCM_HWQP(hwqp)->eq.auto_arm_flag = false;
 
+	BCM_HWQP(hwqp)->wq.db_batch = true;
+	BCM_HWQP(hwqp)->wq.num_pending = 0;
+	BCM_HWQP(hwqp)->wq.wqec_cnt = nvmf_fc_default_wqec_cnt(&BCM_HWQP(hwqp)->wq);
+
+	hdr->repost_batch = MAX_RQ_REPOST_BATCH_CNT;
+	hdr->num_pending = 0;
+	hdr->num_posted = 0;
+
+	nvmf_fc_init_wqe_templates(hwqp);
+	memset(&BCM_HWQP(hwqp)->vtophys_cache, 0, sizeof(struct fc_vtophys_cache));
+
+	BCM_HWQP(hwqp)->xri_cache.low_wm = XRI_CACHE_LOW_WM;
+	BCM_HWQP(hwqp)->xri_cache.high_wm = XRI_CACHE_HIGH_WM;
+	BCM_HWQP(hwqp)->xri_cache.reclaim_gen = BCM_HWQP(hwqp)->xri_list->reclaim_gen;
+	SPDK_STATIC_ASSERT(XRI_CACHE_LOW_WM < XRI_CACHE_HIGH_WM &&
+			   XRI_CACHE_HIGH_WM <= MAX_XRI_CACHE_SIZE, "Invalid XRI cache watermarks");
+
 	BCM_HWQP(hwqp)->cq_wq.auto_arm_flag = true;
 	BCM_HWQP(hwqp)->cq_rq.auto_arm_flag = true;
 
+	/* Only RCQEs carry frames worth prefetching */
+	BCM_HWQP(hwqp)->cq_wq.prefetch_depth = 0;
+	BCM_HWQP(hwqp)->cq_rq.prefetch_depth = spdk_min(BCM_RQ_PREFETCH_DEPTH,
+						     BCM_HWQP(hwqp)->cq_rq.q.max_entries / 2);
+
 	BCM_HWQP(hwqp)->eq.q.type = BCM_FC_QUEUE_TYPE_EQ;
 	BCM_HWQP(hwqp)->cq_wq.q.type = BCM_FC_QUEUE_TYPE_CQ_WQ;
 	BCM_HWQP(hwqp)->wq.q.type = BCM_FC_QUEUE_TYPE_WQ;
@@ -2039,6 +2939,29 @@ nvmf_fc_init_rqpair_buffers(struct spdk_nvmf_fc_hwqp *hwqp)
 	BCM_HWQP(hwqp)->rq_hdr.q.type = BCM_FC_QUEUE_TYPE_RQ_HDR;
 	BCM_HWQP(hwqp)->rq_payload.q.type = BCM_FC_QUEUE_TYPE_RQ_DATA;
 
+	if (!nvmf_fc_queue_size_valid(&BCM_HWQP(hwqp)->eq.q) ||
+	    !nvmf_fc_queue_size_valid(&BCM_HWQP(hwqp)->cq_wq.q) ||
+	    !nvmf_fc_queue_size_valid(&BCM_HWQP(hwqp)->cq_rq.q) ||
+	    !nvmf_fc_queue_size_valid(&BCM_HWQP(hwqp)->wq.q) ||
+	    !nvmf_fc_queue_size_valid(&hdr->q) ||
+	    !nvmf_fc_queue_size_valid(&payload->q)) {
+		SPDK_ERRLOG("%s: hwqp %d queue sizes must be a power of 2\n",
+			    __func__, hwqp->hwqp_id);
+		assert(0);
+		return -1;
+	}
+
+	/*
+	 * WQEs are built in place in the ring and the FCP/SEND_FRAME WQEs
+	 * carry inline payload past the first 64 bytes.
+	 */
+	if (BCM_HWQP(hwqp)->wq.q.size != BCM_WQE_EXT_BYTES) {
+		SPDK_ERRLOG("%s: hwqp %d WQ entry size %d, expected %d\n", __func__,
+			    hwqp->hwqp_id, BCM_HWQP(hwqp)->wq.q.size, (int)BCM_WQE_EXT_BYTES);
+		assert(0);
+		return -1;
+	}
+
 	if (hdr->q.max_entries != payload->q.max_entries) {
 		assert(0);
 	}
@@ -2061,6 +2984,7 @@ nvmf_fc_init_rqpair_buffers(struct spdk_nvmf_fc_hwqp *hwqp)
 	if (!rc) {
 		/* Ring doorbell for one less */
 		nvmf_fc_bcm_notify_queue(&hdr->q, false, (hdr->q.max_entries - 1));
+		hdr->num_posted = hdr->q.max_entries - 1;
 	}
 
 	return rc;
@@ -2069,6 +2993,11 @@ nvmf_fc_init_rqpair_buffers(struct spdk_nvmf_fc_hwqp *hwqp)
 static int
 nvmf_fc_set_q_online_state(struct spdk_nvmf_fc_hwqp *hwqp, bool online)
 {
+	if (!online) {
+		/* Give cached XRIs back to the port, on the thread owning the cache */
+		nvmf_fc_hwqp_send_msg(hwqp, nvmf_fc_xri_cache_drain_msg, 0, 0);
+	}
+
 	BCM_HWQP(hwqp)->free_rq_slots = BCM_HWQP(hwqp)->rq_payload.num_buffers;
 	hwqp->num_conns = 0;
 	return 0;
@@ -2087,7 +3016,7 @@ nvmf_fc_abort_cmpl_cb(void *ctx, uint8_t *cqe, int32_t status, void *arg)
 		carg->cb(hwqp, status, carg->cb_args);
 	}
 
-	free(carg);
+	nvmf_fc_caller_ctx_put(hwqp, carg);
 }
 
 static int
@@ -2100,7 +3029,7 @@ nvmf_fc_issue_abort(struct spdk_nvmf_fc_hwqp *hwqp,
 	struct spdk_nvmf_fc_caller_ctx *ctx = NULL;
 	int rc = -1;
 
-	ctx = calloc(1, sizeof(struct spdk_nvmf_fc_caller_ctx));
+	ctx = nvmf_fc_caller_ctx_get(hwqp);
 	if (!ctx) {
 		goto done;
 	}
@@ -2125,7 +3054,7 @@ nvmf_fc_issue_abort(struct spdk_nvmf_fc_hwqp *hwqp,
 	rc = nvmf_fc_post_wqe(hwqp, (uint8_t *)abort, true, nvmf_fc_abort_cmpl_cb, ctx);
 done:
 	if (rc && ctx) {
-		free(ctx);
+		nvmf_fc_caller_ctx_put(hwqp, ctx);
 	}
 
 	if (!rc) {
@@ -2139,12 +3068,22 @@ done:
 static struct spdk_nvmf_fc_xchg *
 nvmf_fc_get_xri(struct spdk_nvmf_fc_hwqp *hwqp)
 {
+	struct bcm_nvmf_hw_queues *hwq = BCM_HWQP(hwqp);
+	struct fc_xri_cache *cache = &hwq->xri_cache;
 	struct spdk_nvmf_fc_xchg *xri[1];
 
-	/* Get the physical port from the hwqp and dequeue an XRI from the
-	 * corresponding ring. Send this back.
-	 */
-	if (1 != spdk_ring_dequeue(BCM_HWQP(hwqp)->xri_list->xri_ring, (void **)xri, 1)) {
+	/* Refill the hwqp cache from the port XRI ring in one shot */
+	if (!cache->count && cache->high_wm) {
+		cache->count = spdk_ring_dequeue(hwq->xri_list->xri_ring,
+						 (void **)cache->xri, cache->low_wm);
+	}
+
+	if (cache->count) {
+		xri[0] = cache->xri[--cache->count];
+	} else if (1 != spdk_ring_dequeue(hwq->xri_list->xri_ring, (void **)xri, 1)) {
+		hwq->io_cnt->xri_exhausted++;
+		/* Ask the other hwqps of the port to give their cached XRIs back */
+		__atomic_add_fetch(&hwq->xri_list->reclaim_gen, 1, __ATOMIC_RELAXED);
 		return NULL;
 	}
 
@@ -2158,9 +3097,20 @@ nvmf_fc_get_xri(struct spdk_nvmf_fc_hwqp *hwqp)
 static int
 nvmf_fc_put_xri(struct spdk_nvmf_fc_hwqp *hwqp, struct spdk_nvmf_fc_xchg *xri)
 {
+	struct bcm_nvmf_hw_queues *hwq = BCM_HWQP(hwqp);
+	struct fc_xri_cache *cache = &hwq->xri_cache;
 	void *xxri[1];
-	xxri[0] = xri;
-	return spdk_ring_enqueue(BCM_HWQP(hwqp)->xri_list->xri_ring, xxri, 1, NULL);
+
+	if (!cache->high_wm || cache->count >= MAX_XRI_CACHE_SIZE) {
+		xxri[0] = xri;
+		return spdk_ring_enqueue(hwq->xri_list->xri_ring, xxri, 1, NULL);
+	}
+
+	cache->xri[cache->count++] = xri;
+	if (cache->count >= cache->high_wm) {
+		nvmf_fc_xri_cache_drain(hwq, cache->low_wm);
+	}
+	return 1;
 }
 
 static inline void
@@ -2246,7 +3196,7 @@ nvmf_fc_bls_cmpl_cb(void *ctx, uint8_t *cqe, int32_t status, void *arg)
 		carg->cb(hwqp, status, carg->cb_args);
 	}
 
-	free(carg);
+	nvmf_fc_caller_ctx_put(hwqp, carg);
 }
 
 static void
@@ -2266,7 +3216,7 @@ nvmf_fc_srsr_cmpl_cb(void *ctx, uint8_t *cqe, int32_t status, void *arg)
 		carg->cb(hwqp, status, carg->cb_args);
 	}
 
-	free(carg);
+	nvmf_fc_caller_ctx_put(hwqp, carg);
 }
 
 static void
@@ -2331,6 +3281,8 @@ nvmf_fc_io_cmpl_cb(void *ctx, uint8_t *cqe, int32_t status, void *arg)
 
 	/* IO completed successfully */
 	spdk_nvmf_fc_request_set_state(fc_req, SPDK_NVMF_FC_REQ_SUCCESS);
+	nvmf_fc_lat_done(fc_req);
+	nvmf_fc_count_done(fc_req);
 
 io_done:
 	if (fc_req->xchg) {
@@ -2351,8 +3303,18 @@ static void
 nvmf_fc_process_wqe_completion(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t tag, int status,
 			       uint8_t *cqe)
 {
+	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
 	fc_reqtag_t *reqtag;
 
+	if (wq->sf_reqtag && tag == wq->sf_reqtag->index) {
+		/* Send-frame response, completed when it was posted */
+		BCM_HWQP(hwqp)->stats.sf_cmpls++;
+		if (status) {
+			BCM_HWQP(hwqp)->stats.sf_cmpl_err++;
+		}
+		return;
+	}
+
 	reqtag = nvmf_fc_lookup_reqtag(hwqp, tag);
 	if (!reqtag) {
 		SPDK_ERRLOG("Could not find reqtag(%d) for WQE Compl HWQP = %d\n",
@@ -2376,10 +3338,225 @@ nvmf_fc_process_wqe_completion(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t tag, int
 }
 
 static void
-nvmf_fc_process_wqe_release(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t wqid)
+nvmf_fc_process_wqe_release(struct spdk_nvmf_fc_hwqp *hwqp, uint16_t wqid, uint8_t *cqe)
+{
+	cqe_t *cqe_entry = (cqe_t *)cqe;
+	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
+
+	if (wqid != wq->q.qid) {
+		SPDK_ERRLOG("%s: release for WQ %d on hwqp %d\n", __func__, wqid, hwqp->hwqp_id);
+		return;
+	}
+
+	/*
+	 * The HBA has consumed every WQE up to and including wqe_index,
+	 * however many WQEs that covers.
+	 */
+	wq->q.tail = (cqe_entry->u.wqec.wqe_index + 1) & wq->q.mask;
+	wq->q.used = (wq->q.head - wq->q.tail) & wq->q.mask;
+	BCM_HWQP(hwqp)->stats.wq_releases++;
+
+	SPDK_DEBUGLOG(SPDK_LOG_NVMF_FC_LLD, "WQE RELEASE index %d used %d\n",
+		      cqe_entry->u.wqec.wqe_index, wq->q.used);
+}
+
+int
+spdk_nvmf_fc_check_wqec_cnt(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t wqec_cnt)
+{
+	struct fc_wrkq *wq = &BCM_HWQP(hwqp)->wq;
+
+	if (!wqec_cnt) {
+		wqec_cnt = nvmf_fc_default_wqec_cnt(wq);
+	}
+
+	/* Keep several strides in flight so the near full rule stays rare */
+	return wqec_cnt > wq->q.max_entries / 4 ? -EINVAL : 0;
+}
+
+static void
+nvmf_fc_wqec_cnt_apply(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t wqec_cnt, uint32_t unused)
+{
+	BCM_HWQP(hwqp)->wq.wqec_cnt = wqec_cnt;
+}
+
+int
+spdk_nvmf_fc_set_wqec_cnt(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t wqec_cnt)
+{
+	if (spdk_nvmf_fc_check_wqec_cnt(hwqp, wqec_cnt)) {
+		return -EINVAL;
+	}
+
+	if (!wqec_cnt) {
+		wqec_cnt = nvmf_fc_default_wqec_cnt(&BCM_HWQP(hwqp)->wq);
+	}
+
+	return nvmf_fc_hwqp_send_msg(hwqp, nvmf_fc_wqec_cnt_apply, wqec_cnt, 0);
+}
+
+static void
+nvmf_fc_rq_prefetch_depth_apply(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t depth, uint32_t unused)
+{
+	BCM_HWQP(hwqp)->cq_rq.prefetch_depth = depth;
+}
+
+int
+spdk_nvmf_fc_check_rq_prefetch_depth(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t depth)
+{
+	/* Same bound as the default, the lookahead stays within the CQ */
+	return depth > BCM_HWQP(hwqp)->cq_rq.q.max_entries / 2 ? -EINVAL : 0;
+}
+
+int
+spdk_nvmf_fc_set_rq_prefetch_depth(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t depth)
+{
+	if (spdk_nvmf_fc_check_rq_prefetch_depth(hwqp, depth)) {
+		return -EINVAL;
+	}
+
+	return nvmf_fc_hwqp_send_msg(hwqp, nvmf_fc_rq_prefetch_depth_apply, depth, 0);
+}
+
+static void
+nvmf_fc_xri_cache_wm_apply(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t low_wm, uint32_t high_wm)
+{
+	struct fc_xri_cache *cache = &BCM_HWQP(hwqp)->xri_cache;
+
+	cache->low_wm = low_wm;
+	cache->high_wm = high_wm;
+
+	/* Trim a cache now holding more than the new high_wm allows */
+	if (!high_wm) {
+		nvmf_fc_xri_cache_drain(BCM_HWQP(hwqp), 0);
+	} else if (cache->count >= high_wm) {
+		nvmf_fc_xri_cache_drain(BCM_HWQP(hwqp), low_wm);
+	}
+}
+
+int
+spdk_nvmf_fc_check_xri_cache_wm(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t low_wm,
+				uint32_t high_wm)
 {
-	BCM_HWQP(hwqp)->wq.q.used -= MAX_WQ_WQEC_CNT;
-	SPDK_DEBUGLOG(SPDK_LOG_NVMF_FC_LLD, "WQE RELEASE\n");
+	return high_wm && (low_wm >= high_wm || high_wm > MAX_XRI_CACHE_SIZE) ? -EINVAL : 0;
+}
+
+int
+spdk_nvmf_fc_set_xri_cache_wm(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t low_wm,
+			      uint32_t high_wm)
+{
+	if (spdk_nvmf_fc_check_xri_cache_wm(hwqp, low_wm, high_wm)) {
+		return -EINVAL;
+	}
+
+	return nvmf_fc_hwqp_send_msg(hwqp, nvmf_fc_xri_cache_wm_apply, low_wm, high_wm);
+}
+
+/*
+ * Translate vaddr through the hwqp vtophys cache, calling spdk_vtophys()
+ * only on a miss.
+ */
+static uint64_t
+nvmf_fc_vtophys(struct spdk_nvmf_fc_hwqp *hwqp, void *vaddr)
+{
+	struct fc_vtophys_cache *cache = &BCM_HWQP(hwqp)->vtophys_cache;
+	uint64_t va = (uint64_t)vaddr;
+	uint64_t vpage = va >> VTOPHYS_PAGE_SHIFT;
+	uint64_t size = VTOPHYS_PAGE_SIZE;
+	uint64_t phys;
+	uint32_t idx = vpage & (VTOPHYS_CACHE_SIZE - 1);
+	uint32_t gen = __atomic_load_n(&g_nvmf_fc_vtophys_gen, __ATOMIC_ACQUIRE);
+
+	if (spdk_unlikely(cache->gen != gen)) {
+		/* memory was unregistered since the cache was filled */
+		memset(cache->entry, 0, sizeof(cache->entry));
+		cache->gen = gen;
+	}
+
+	if (spdk_likely(cache->entry[idx].vpage == vpage)) {
+		BCM_HWQP(hwqp)->stats.vtophys_hits++;
+		return cache->entry[idx].phys + (va & VTOPHYS_PAGE_MASK);
+	}
+
+	BCM_HWQP(hwqp)->stats.vtophys_misses++;
+	phys = spdk_vtophys((void *)(va & ~VTOPHYS_PAGE_MASK), &size);
+	if (phys == SPDK_VTOPHYS_ERROR) {
+		return SPDK_VTOPHYS_ERROR;
+	}
+
+	cache->entry[idx].vpage = vpage;
+	cache->entry[idx].phys = phys;
+
+	return phys + (va & VTOPHYS_PAGE_MASK);
+}
+
+/*
+ * Returns the length (up to len) of the physically contiguous run that
+ * starts at vaddr and its physical address in *phys, or 0 if vaddr can't
+ * be translated.
+ */
+static uint64_t
+nvmf_fc_vtophys_run(struct spdk_nvmf_fc_hwqp *hwqp, void *vaddr, uint64_t len,
+		    uint64_t *phys)
+{
+	uint64_t va = (uint64_t)vaddr;
+	uint64_t run;
+
+	*phys = nvmf_fc_vtophys(hwqp, vaddr);
+	if (*phys == SPDK_VTOPHYS_ERROR) {
+		return 0;
+	}
+
+	run = spdk_min(len, VTOPHYS_PAGE_SIZE - (va & VTOPHYS_PAGE_MASK));
+	while (run < len) {
+		if (nvmf_fc_vtophys(hwqp, (void *)(va + run)) != (*phys + run)) {
+			break;
+		}
+		run += spdk_min(len - run, VTOPHYS_PAGE_SIZE);
+	}
+
+	return run;
+}
+
+/*
+ * Returns true if the request data is one physically contiguous region,
+ * so the WQE can carry it in its BDE and the HBA skips the SGL fetch.
+ * This is common for small split I/Os whose iovecs are adjacent.
+ */
+static bool
+nvmf_fc_data_is_contig(struct spdk_nvmf_fc_request *fc_req, uint64_t *phys)
+{
+	struct iovec *iov = fc_req->req.iov;
+	uint8_t *end;
+	uint32_t i;
+
+	if (fc_req->req.iovcnt > BCM_CONTIG_IOVCNT_MAX) {
+		return false;
+	}
+
+	end = (uint8_t *)iov[0].iov_base + iov[0].iov_len;
+	for (i = 1; i < fc_req->req.iovcnt; i++) {
+		if (iov[i].iov_base != end) {
+			return false;
+		}
+		end += iov[i].iov_len;
+	}
+
+	return nvmf_fc_vtophys_run(fc_req->hwqp, iov[0].iov_base, fc_req->req.length,
+				   phys) == fc_req->req.length;
+}
+
+/* Write a whole SGE with a single store, other fields zero */
+static inline void
+nvmf_fc_set_sge(bcm_sge_t *sge, uint32_t type, uint64_t phys, uint32_t len,
+		uint32_t offset)
+{
+	bcm_sge_t tmp = { 0 };
+
+	tmp.sge_type = type;
+	tmp.buffer_address_low  = PTR_TO_ADDR32_LO(phys);
+	tmp.buffer_address_high = PTR_TO_ADDR32_HI(phys);
+	tmp.buffer_length = len;
+	tmp.data_offset = offset;
+	*sge = tmp;
 }
 
 static uint32_t
@@ -2387,8 +3564,8 @@ nvmf_fc_fill_sgl(struct spdk_nvmf_fc_request *fc_req)
 {
 	uint32_t i;
 	uint32_t offset = 0;
-	uint64_t iov_phys;
-	bcm_sge_t *sge = NULL;
+	uint64_t iov_phys, run;
+	bcm_sge_t *sge = NULL, *sge_end, *last = NULL;
 	struct spdk_nvmf_fc_rq_buf_nvme_cmd *req_buf = NULL;
 	struct spdk_nvmf_fc_hwqp *hwqp = fc_req->hwqp;
 
@@ -2406,9 +3583,12 @@ nvmf_fc_fill_sgl(struct spdk_nvmf_fc_request *fc_req)
 	/* Use RQ buffer for SGL */
 	req_buf = BCM_HWQP(hwqp)->rq_payload.buffer[fc_req->buf_index].virt;
 	sge = &req_buf->sge[0];
+	sge_end = &req_buf->sge[BCM_MAX_IOVECS];
 
-	memset(sge, 0, (sizeof(bcm_sge_t) * BCM_MAX_IOVECS));
-
+	/*
+	 * Each SGE is written whole, so the unused tail of the SGL is left
+	 * as is rather than zeroed; the HBA stops at the last SGE.
+	 */
 	if (fc_req->req.xfer == SPDK_NVME_DATA_HOST_TO_CONTROLLER) { /* Write */
 		uint64_t xfer_rdy_phys;
 		struct spdk_nvmf_fc_xfer_rdy_iu *xfer_rdy_iu;
@@ -2422,44 +3602,54 @@ nvmf_fc_fill_sgl(struct spdk_nvmf_fc_request *fc_req)
 		xfer_rdy_phys = BCM_HWQP(hwqp)->rq_payload.buffer[fc_req->buf_index].phys +
 				offsetof(struct spdk_nvmf_fc_rq_buf_nvme_cmd, xfer_rdy);
 
-		sge->sge_type = BCM_SGE_TYPE_DATA;
-		sge->buffer_address_low  = PTR_TO_ADDR32_LO(xfer_rdy_phys);
-		sge->buffer_address_high = PTR_TO_ADDR32_HI(xfer_rdy_phys);
-		sge->buffer_length = sizeof(struct spdk_nvmf_fc_xfer_rdy_iu);
+		nvmf_fc_set_sge(sge, BCM_SGE_TYPE_DATA, xfer_rdy_phys,
+				sizeof(struct spdk_nvmf_fc_xfer_rdy_iu), 0);
 		sge++;
 
 	} else if (fc_req->req.xfer == SPDK_NVME_DATA_CONTROLLER_TO_HOST) { /* read */
 		/* 1st SGE is skip. */
-		sge->sge_type = BCM_SGE_TYPE_SKIP;
+		nvmf_fc_set_sge(sge, BCM_SGE_TYPE_SKIP, 0, 0, 0);
 		sge++;
 	} else {
 		return 0;
 	}
 
 	/* 2nd SGE is skip. */
-	sge->sge_type = BCM_SGE_TYPE_SKIP;
+	nvmf_fc_set_sge(sge, BCM_SGE_TYPE_SKIP, 0, 0, 0);
 	sge++;
 
 	for (i = 0; i < fc_req->req.iovcnt; i++) {
-		size_t mapped_size = fc_req->req.iov[i].iov_len;
+		uint8_t *iov_base = fc_req->req.iov[i].iov_base;
+		uint64_t iov_len = fc_req->req.iov[i].iov_len;
+
+		/* One SGE per physically contiguous run of the iovec */
+		while (iov_len) {
+			run = nvmf_fc_vtophys_run(hwqp, iov_base, iov_len, &iov_phys);
+			if (!run) {
+				SPDK_ERRLOG("Error: vtophys failed for %p\n", iov_base);
+				return 0;
+			}
+			if (sge == sge_end) {
+				SPDK_ERRLOG("Error: SGL needs more than %d SGEs\n", BCM_MAX_IOVECS);
+				return 0;
+			}
+			if (run < iov_len) {
+				BCM_HWQP(hwqp)->stats.sgl_splits++;
+			}
 
-		iov_phys = spdk_vtophys(fc_req->req.iov[i].iov_base, &mapped_size);
-		/* ocs_assert(mapped_size == fc_req->req.iov[i].iov_len, 0);
-		 */
-		sge->sge_type = BCM_SGE_TYPE_DATA;
-		sge->buffer_address_low  = PTR_TO_ADDR32_LO(iov_phys);
-		sge->buffer_address_high = PTR_TO_ADDR32_HI(iov_phys);
-		sge->buffer_length = fc_req->req.iov[i].iov_len;
-		sge->data_offset = offset;
-		offset += fc_req->req.iov[i].iov_len;
-
-		if (i == (fc_req->req.iovcnt - 1)) {
-			/* last */
-			sge->last = true;
-		} else {
+			nvmf_fc_set_sge(sge, BCM_SGE_TYPE_DATA, iov_phys, run, offset);
+			offset += run;
+			iov_base += run;
+			iov_len -= run;
+
+			last = sge;
 			sge++;
 		}
 	}
+
+	if (last) {
+		last->last = true;
+	}
 	return offset;
 }
 
@@ -2467,24 +3657,23 @@ static int
 nvmf_fc_recv_data(struct spdk_nvmf_fc_request *fc_req)
 {
 	int rc = 0;
-	uint8_t wqe[128] = { 0 };
-	bcm_fcp_treceive64_wqe_t *trecv = (bcm_fcp_treceive64_wqe_t *)wqe;
+	uint64_t bde_phys;
+	bcm_fcp_treceive64_wqe_t *trecv;
 	struct spdk_nvmf_fc_hwqp *hwqp = fc_req->hwqp;
 
 	if (!fc_req->req.iovcnt) {
 		return -1;
 	}
 
-	trecv->xbl = true;
-	if (fc_req->req.iovcnt == 1) {
-		/* Data is a single physical address, use a BDE */
-		uint64_t bde_phys;
-		size_t phys_map_size;
-
-		phys_map_size = (size_t)fc_req->req.length;
-		bde_phys = spdk_vtophys(fc_req->req.iov[0].iov_base, &phys_map_size);
-		/* ocs_assert(phys_map_size == (size_t)fc_req->req.length, 0);
-		 */
+	/* Build the WQE in place in the WQ ring */
+	trecv = (bcm_fcp_treceive64_wqe_t *)nvmf_fc_wqe_reserve(hwqp,
+			BCM_HWQP(hwqp)->wqe_tmpl.trecv);
+	if (!trecv) {
+		return -1;
+	}
+
+	if (nvmf_fc_data_is_contig(fc_req, &bde_phys)) {
+		/* Data is physically contiguous, use a BDE */
 		trecv->dbde = true;
 		trecv->bde.bde_type = BCM_BDE_TYPE_BDE_64;
 		trecv->bde.buffer_length = fc_req->req.length;
@@ -2506,29 +3695,16 @@ nvmf_fc_recv_data(struct spdk_nvmf_fc_request *fc_req)
 		trecv->bde.u.blp.sgl_segment_address_high = PTR_TO_ADDR32_HI(sgl_phys);
 	}
 
-	trecv->relative_offset = 0;
 	trecv->xri_tag = fc_req->xchg->xchg_id;
 	trecv->context_tag = fc_req->rpi;
-	trecv->pu = true;
-	trecv->ar = false;
-
-	trecv->command = BCM_WQE_FCP_TRECEIVE64;
-	trecv->class = BCM_ELS_REQUEST64_CLASS_3;
-	trecv->ct = BCM_ELS_REQUEST64_CONTEXT_RPI;
-
 	trecv->remote_xid = fc_req->oxid;
-	trecv->nvme 	= 1;
-	trecv->iod 	= 1;
-	trecv->len_loc 	= 0x2;
-	trecv->timer 	= 30;
-
-	trecv->cmd_type = BCM_CMD_FCP_TRECEIVE64_WQE;
-	trecv->cq_id = 0xFFFF;
 	trecv->fcp_data_receive_length = fc_req->req.length;
 
-	rc = nvmf_fc_post_wqe(hwqp, (uint8_t *)trecv, true, nvmf_fc_io_cmpl_cb, fc_req);
+	rc = nvmf_fc_wqe_commit(hwqp, (uint8_t *)trecv, true, nvmf_fc_io_cmpl_cb, fc_req);
 	if (!rc) {
 		fc_req->xchg->active = true;
+		nvmf_fc_lat_data(fc_req);
+		nvmf_fc_count_write(fc_req);
 	}
 
 	return rc;
@@ -2549,6 +3725,8 @@ nvmf_fc_process_marker_cqe(struct spdk_nvmf_fc_hwqp *hwqp, uint8_t *cqe)
 			      poller_args->tag);
 		spdk_nvmf_fc_poller_api_func(hwqp, SPDK_NVMF_FC_POLLER_API_QUEUE_SYNC_DONE,
 					     poller_args);
+	} else {
+		BCM_HWQP(hwqp)->stats.marker_args_alloc_err++;
 	}
 }
 
@@ -2594,6 +3772,7 @@ nvmf_fc_process_rqpair(struct spdk_nvmf_fc_hwqp *hwqp, fc_eventq_t *cq, uint8_t
 			}
 
 			buff_idx = nvmf_fc_rqpair_get_buffer_id(hwqp, rq_index);
+			BCM_HWQP(hwqp)->rq_hdr.num_posted--;
 			goto buffer_release;
 
 		case BCM_FC_ASYNC_RQ_INSUFF_BUF_NEEDED:
@@ -2619,6 +3798,9 @@ nvmf_fc_process_rqpair(struct spdk_nvmf_fc_hwqp *hwqp, fc_eventq_t *cq, uint8_t
 		return -1;
 	}
 
+	/* The adapter consumed a buffer for this frame */
+	BCM_HWQP(hwqp)->rq_hdr.num_posted--;
+
 	/* Process NVME frame */
 	buff_idx = nvmf_fc_rqpair_get_buffer_id(hwqp, rq_index);
 	frame = nvmf_fc_rqpair_get_frame_header(hwqp, rq_index);
@@ -2628,6 +3810,8 @@ nvmf_fc_process_rqpair(struct spdk_nvmf_fc_hwqp *hwqp, fc_eventq_t *cq, uint8_t
 		/* Process marker completion */
 		nvmf_fc_process_marker_cqe(hwqp, cqe);
 	} else {
+		nvmf_fc_lat_rx(hwqp, buff_idx);
+		BCM_HWQP(hwqp)->io_cnt->cmds_rcvd++;
 		rc = spdk_nvmf_fc_hwqp_process_frame(hwqp, buff_idx, frame, payload_buffer,
 						    rcqe->payload_data_placement_length);
 		if (!rc) {
@@ -2641,22 +3825,127 @@ buffer_release:
 	return rc;
 }
 
+/*
+ * Feed one pass over an EQ/CQ into its limit controller and retune
+ * processed_limit/posted_limit at the end of each interval.
+ */
+static void
+nvmf_fc_limit_ctl_update(struct fc_eventq *eq, uint32_t entries, bool budget_hit)
+{
+	struct fc_q_limit_ctl *ctl = &eq->limit_ctl;
+	struct fc_q_limit_hist *hist;
+	uint32_t avg, limit;
+
+	if (!ctl->enabled) {
+		return;
+	}
+
+	ctl->passes++;
+	ctl->entries += entries;
+	if (budget_hit) {
+		ctl->budget_hits++;
+	}
+
+	if (ctl->passes < BCM_Q_LIMIT_INTERVAL) {
+		return;
+	}
+
+	avg = ctl->entries / ctl->passes;
+	limit = eq->q.processed_limit;
+
+	if (ctl->budget_hits > (ctl->passes / 4)) {
+		/* Saturated: process more per pass, coalesce more doorbells */
+		limit = spdk_min(limit * 2, spdk_min(BCM_Q_PROCESSED_LIMIT_MAX,
+						     (uint32_t)eq->q.max_entries));
+	} else if ((avg * 4) < limit) {
+		/* Lightly used: give entries back to the adapter sooner */
+		limit = spdk_max(limit / 2, BCM_Q_PROCESSED_LIMIT_MIN);
+	}
+
+	eq->q.processed_limit = limit;
+	eq->q.posted_limit = spdk_max(spdk_min(limit / 4, BCM_Q_POSTED_LIMIT_MAX),
+				      BCM_Q_POSTED_LIMIT_MIN);
+
+	hist = &ctl->history[ctl->adjustments % BCM_Q_LIMIT_HISTORY];
+	hist->processed_limit = eq->q.processed_limit;
+	hist->posted_limit = eq->q.posted_limit;
+	hist->avg_entries = avg;
+	hist->budget_hits = ctl->budget_hits;
+	ctl->adjustments++;
+
+	ctl->passes = 0;
+	ctl->budget_hits = 0;
+	ctl->entries = 0;
+}
+
+/*
+ * Look prefetch_depth RCQEs ahead of the tail and prefetch the header and
+ * payload buffers of that frame, so they are cache resident by the time
+ * nvmf_fc_process_rqpair() gets to it.
+ */
+static inline void
+nvmf_fc_rqpair_prefetch(struct spdk_nvmf_fc_hwqp *hwqp, struct fc_eventq *cq)
+{
+	bcm_sli_queue_t *q = &cq->q;
+	struct fc_rcvq *hdr = &BCM_HWQP(hwqp)->rq_hdr;
+	uint8_t *cqe;
+	uint32_t rq_index, buf_index;
+
+	cqe = q->address + ((q->tail + cq->prefetch_depth) & q->mask) * q->size;
+	if (!(cqe[15] & 0x80)) {
+		return;
+	}
+
+	switch (cqe[BCM_CQE_CODE_OFFSET]) {
+	case BCM_CQE_CODE_RQ_ASYNC:
+		rq_index = ((bcm_fc_async_rcqe_t *)cqe)->rq_element_index;
+		break;
+	case BCM_CQE_CODE_RQ_ASYNC_V1:
+		rq_index = ((bcm_fc_async_rcqe_v1_t *)cqe)->rq_element_index;
+		break;
+	default:
+		return;
+	}
+
+	if (rq_index >= hdr->q.max_entries) {
+		return;
+	}
+
+	buf_index = hdr->rq_map[rq_index];
+	__builtin_prefetch(hdr->buffer[buf_index].virt);
+	/* NVMe command IU spans two cache lines */
+	__builtin_prefetch(BCM_HWQP(hwqp)->rq_payload.buffer[buf_index].virt);
+	__builtin_prefetch((uint8_t *)BCM_HWQP(hwqp)->rq_payload.buffer[buf_index].virt + 64);
+}
+
 static int
 nvmf_fc_process_cq_entry(struct spdk_nvmf_fc_hwqp *hwqp, struct fc_eventq *cq)
 {
 	int rc = 0, budget = cq->q.processed_limit;
-	uint8_t	cqe[sizeof(cqe_t)];
+	uint8_t	*cqe;
 	uint16_t rid = UINT16_MAX;
 	uint32_t n_processed = 0;
+	uint32_t n_frames = 0;
+	uint32_t consumed;
+	uint64_t start_ticks = 0;
+	bool rq_cq = (cq->q.type == BCM_FC_QUEUE_TYPE_CQ_RQ);
 	bcm_qentry_type_e ctype;     /* completion type */
 
 	assert(hwqp);
 	assert(cq);
 
-	while (!nvmf_fc_read_queue_entry(&cq->q, &cqe[0])) {
+	if (rq_cq) {
+		start_ticks = spdk_get_ticks();
+	}
+
+	while ((cqe = nvmf_fc_cq_peek(&cq->q)) != NULL) {
 		n_processed++;
 		budget --;
 
+		if (cq->prefetch_depth) {
+			nvmf_fc_rqpair_prefetch(hwqp, cq);
+		}
+
 		rc = nvmf_fc_parse_cq_entry(cq, cqe, &ctype, &rid);
 		/*
 		 * The sign of status is significant. If status is:
@@ -2665,6 +3954,7 @@ nvmf_fc_process_cq_entry(struct spdk_nvmf_fc_hwqp *hwqp, struct fc_eventq *cq)
 		 *  < 0 : call failed and no information is available about the CQE
 		 */
 		if (rc < 0) {
+			nvmf_fc_cq_consume(&cq->q, cqe);
 			if ((rc == -2) && budget) {
 				/* Entry was consumed */
 				continue;
@@ -2677,10 +3967,11 @@ nvmf_fc_process_cq_entry(struct spdk_nvmf_fc_hwqp *hwqp, struct fc_eventq *cq)
 			nvmf_fc_process_wqe_completion(hwqp, rid, rc, cqe);
 			break;
 		case BCM_FC_QENTRY_WQ_RELEASE:
-			nvmf_fc_process_wqe_release(hwqp, rid);
+			nvmf_fc_process_wqe_release(hwqp, rid, cqe);
 			break;
 		case BCM_FC_QENTRY_RQ:
 			nvmf_fc_process_rqpair(hwqp, cq, cqe);
+			n_frames++;
 			break;
 		case BCM_FC_QENTRY_XABT:
 			nvmf_fc_nvmf_del_xri_pending(hwqp, rid);
@@ -2692,6 +3983,9 @@ nvmf_fc_process_cq_entry(struct spdk_nvmf_fc_hwqp *hwqp, struct fc_eventq *cq)
 			break;
 		}
 
+		/* Entry was processed in place, give it back */
+		nvmf_fc_cq_consume(&cq->q, cqe);
+
 		if (n_processed >= (cq->q.posted_limit)) {
 			nvmf_fc_bcm_notify_queue(&cq->q, false, n_processed);
 			n_processed = 0;
@@ -2704,6 +3998,16 @@ nvmf_fc_process_cq_entry(struct spdk_nvmf_fc_hwqp *hwqp, struct fc_eventq *cq)
 
 	nvmf_fc_bcm_notify_queue(&cq->q, cq->auto_arm_flag, n_processed);
 
+	/* Before the update, which may retune processed_limit */
+	consumed = cq->q.processed_limit - budget;
+	nvmf_fc_limit_ctl_update(cq, consumed, !budget);
+	BCM_HWQP(hwqp)->io_cnt->cqes += consumed;
+
+	if (n_frames) {
+		BCM_HWQP(hwqp)->stats.rq_frames += n_frames;
+		BCM_HWQP(hwqp)->stats.rq_ticks += spdk_get_ticks() - start_ticks;
+	}
+
 	return rc;
 }
 
@@ -2713,7 +4017,8 @@ nvmf_fc_process_queue(struct spdk_nvmf_fc_hwqp *hwqp)
 	int rc = 0, budget = 0;
 	uint32_t n_processed = 0;
 	uint32_t n_processed_total = 0;
-	uint8_t eqe[sizeof(eqe_t)] = { 0 };
+	uint32_t consumed;
+	eqe_t *eqe;
 	uint16_t cq_id;
 	struct fc_eventq *eq;
 	bool pending_req_processed = false;
@@ -2725,14 +4030,22 @@ nvmf_fc_process_queue(struct spdk_nvmf_fc_hwqp *hwqp)
 	}
 
 	eq = &BCM_HWQP(hwqp)->eq;
+	BCM_HWQP(hwqp)->io_cnt->polls++;
+
+	/* Notify WQEs and RQ buffers posted outside of the poller since the last poll */
+	nvmf_fc_flush_wq(hwqp);
+	nvmf_fc_flush_rq(hwqp);
+
+	nvmf_fc_xri_cache_reclaim(BCM_HWQP(hwqp));
 
 	budget = eq->q.processed_limit;
 
-	while (!nvmf_fc_read_queue_entry(&eq->q, &eqe[0])) {
+	while ((eqe = nvmf_fc_eq_peek(&eq->q)) != NULL) {
 		n_processed++;
 		budget --;
 
-		rc = nvmf_fc_parse_eq_entry((struct eqe *)eqe, &cq_id);
+		rc = nvmf_fc_parse_eq_entry(eqe, &cq_id);
+		nvmf_fc_eq_consume(&eq->q, eqe);
 		if (spdk_likely(rc))  {
 			if (rc > 0) {
 				/* EQ is full.  Process all CQs */
@@ -2778,6 +4091,17 @@ nvmf_fc_process_queue(struct spdk_nvmf_fc_hwqp *hwqp)
 		nvmf_fc_bcm_notify_queue(&eq->q, eq->auto_arm_flag, n_processed);
 	}
 
+	/* Before the update, which may retune processed_limit */
+	consumed = eq->q.processed_limit - budget;
+	nvmf_fc_limit_ctl_update(eq, consumed, !budget);
+	if (consumed) {
+		BCM_HWQP(hwqp)->io_cnt->busy_polls++;
+	}
+
+	/* One WQ and one RQ doorbell for everything posted during this poll */
+	nvmf_fc_flush_wq(hwqp);
+	nvmf_fc_flush_rq(hwqp);
+
 	return (n_processed + n_processed_total);
 }
 
@@ -2840,9 +4164,9 @@ static int
 nvmf_fc_send_data(struct spdk_nvmf_fc_request *fc_req)
 {
 	int rc = 0;
-	uint8_t wqe[128] = { 0 };
 	uint32_t xfer_len = 0;
-	bcm_fcp_tsend64_wqe_t *tsend = (bcm_fcp_tsend64_wqe_t *)wqe;
+	uint64_t bde_phys;
+	bcm_fcp_tsend64_wqe_t *tsend;
 	struct spdk_nvmf_fc_hwqp *hwqp = fc_req->hwqp;
 	struct spdk_nvmf_qpair *qpair = fc_req->req.qpair;
 	struct spdk_nvmf_fc_conn *fc_conn = spdk_nvmf_fc_get_conn(qpair);
@@ -2851,23 +4175,22 @@ nvmf_fc_send_data(struct spdk_nvmf_fc_request *fc_req)
 		return -1;
 	}
 
-	tsend->xbl = true;
-	if (fc_req->req.iovcnt == 1) {
-		/* Data is a single physical address, use a BDE */
-		uint64_t bde_phys;
-		size_t phys_map_size;
-
-		phys_map_size = (size_t)fc_req->req.length;
-		bde_phys = spdk_vtophys(fc_req->req.iov[0].iov_base, &phys_map_size);
-		/* ocs_assert(phys_map_size == (size_t)fc_req->req.length, 0);
-		 */
+	/* Build the WQE in place in the WQ ring */
+	tsend = (bcm_fcp_tsend64_wqe_t *)nvmf_fc_wqe_reserve(hwqp,
+			BCM_HWQP(hwqp)->wqe_tmpl.tsend);
+	if (!tsend) {
+		return -1;
+	}
+
+	if (nvmf_fc_data_is_contig(fc_req, &bde_phys)) {
+		/* Data is physically contiguous, use a BDE */
 		tsend->dbde = true;
 		tsend->bde.bde_type = BCM_BDE_TYPE_BDE_64;
 		tsend->bde.buffer_length = fc_req->req.length;
 		tsend->bde.u.data.buffer_address_low = PTR_TO_ADDR32_LO(bde_phys);
 		tsend->bde.u.data.buffer_address_high = PTR_TO_ADDR32_HI(bde_phys);
 
-		xfer_len = fc_req->req.iov[0].iov_len;
+		xfer_len = fc_req->req.length;
 	} else {
 		uint64_t sgl_phys;
 
@@ -2885,10 +4208,10 @@ nvmf_fc_send_data(struct spdk_nvmf_fc_request *fc_req)
 		tsend->bde.u.blp.sgl_segment_address_high = PTR_TO_ADDR32_HI(sgl_phys);
 	}
 
-	tsend->relative_offset = 0;
 	tsend->xri_tag = fc_req->xchg->xchg_id;
 	tsend->rpi = fc_req->rpi;
-	tsend->pu = true;
+	tsend->remote_xid = fc_req->oxid;
+	tsend->fcp_data_transmit_length = fc_req->req.length;
 
 	if (!spdk_nvmf_fc_send_ersp_required(fc_req, (fc_conn->rsp_count + 1),
 					xfer_len)) {
@@ -2898,20 +4221,11 @@ nvmf_fc_send_data(struct spdk_nvmf_fc_request *fc_req)
 		spdk_nvmf_fc_request_set_state(fc_req, SPDK_NVMF_FC_REQ_READ_RSP);
 	}
 
-	tsend->command = BCM_WQE_FCP_TSEND64;
-	tsend->class = BCM_ELS_REQUEST64_CLASS_3;
-	tsend->ct = BCM_ELS_REQUEST64_CONTEXT_RPI;
-	tsend->remote_xid = fc_req->oxid;
-	tsend->nvme = 1;
-	tsend->len_loc = 0x2;
-
-	tsend->cmd_type = BCM_CMD_FCP_TSEND64_WQE;
-	tsend->cq_id = 0xFFFF;
-	tsend->fcp_data_transmit_length = fc_req->req.length;
-
-	rc = nvmf_fc_post_wqe(hwqp, (uint8_t *)tsend, true, nvmf_fc_io_cmpl_cb, fc_req);
+	rc = nvmf_fc_wqe_commit(hwqp, (uint8_t *)tsend, true, nvmf_fc_io_cmpl_cb, fc_req);
 	if (!rc) {
 		fc_req->xchg->active = true;
+		nvmf_fc_lat_data(fc_req);
+		nvmf_fc_count_read(fc_req);
 	}
 
 	return rc;
@@ -2996,6 +4310,17 @@ nvmf_fc_send_frame(struct spdk_nvmf_fc_hwqp *hwqp,
 	sf->cmd_type	 = BCM_CMD_SEND_FRAME_WQE;
 	sf->cq_id	 = 0xffff;
 
+	if (BCM_HWQP(hwqp)->wq.sf_reqtag) {
+		uint8_t *qe = nvmf_fc_wqe_reserve(hwqp, (uint8_t *)sf);
+
+		if (!qe) {
+			return -1;
+		}
+
+		nvmf_fc_wqe_submit(hwqp, qe, true, BCM_HWQP(hwqp)->wq.sf_reqtag->index);
+		return 0;
+	}
+
 	rc = nvmf_fc_post_wqe(hwqp, (uint8_t *)sf, true, nvmf_fc_sendframe_cmpl_cb, NULL);
 
 	return rc;
@@ -3019,6 +4344,7 @@ nvmf_fc_sendframe_rsp(struct spdk_nvmf_fc_request *fc_req,
 		rctl	= FCNVME_R_CTL_ERSP_STATUS;
 	}
 
+	nvmf_fc_lat_rsp(fc_req);
 	rc = nvmf_fc_send_frame(fc_req->hwqp, fc_req->s_id, fc_req->d_id, fc_req->oxid,
 				FCNVME_TYPE_FC_EXCHANGE, rctl, FCNVME_F_CTL_RSP, rsp, rsp_len);
 	if (rc) {
@@ -3044,14 +4370,20 @@ static int
 nvmf_fc_xmt_rsp(struct spdk_nvmf_fc_request *fc_req, uint8_t *ersp_buf, uint32_t ersp_len)
 {
 	int rc = 0;
-	uint8_t wqe[128] = { 0 };
-	bcm_fcp_trsp64_wqe_t *trsp = (bcm_fcp_trsp64_wqe_t *)wqe;
+	bcm_fcp_trsp64_wqe_t *trsp;
 	struct spdk_nvmf_fc_hwqp *hwqp = fc_req->hwqp;
 
 	if (spdk_nvmf_fc_use_send_frame(&fc_req->req)) {
 		return nvmf_fc_sendframe_rsp(fc_req, ersp_buf, ersp_len);
 	}
 
+	/* Build the WQE in place in the WQ ring */
+	trsp = (bcm_fcp_trsp64_wqe_t *)nvmf_fc_wqe_reserve(hwqp,
+			BCM_HWQP(hwqp)->wqe_tmpl.trsp);
+	if (!trsp) {
+		return -1;
+	}
+
 	if (!ersp_buf) {
 		/* Auto-Gen all zeroes in IU 12-byte payload */
 		trsp->ag = true;
@@ -3067,17 +4399,12 @@ nvmf_fc_xmt_rsp(struct spdk_nvmf_fc_request *fc_req, uint8_t *ersp_buf, uint32_t
 		trsp->xc = true;
 	}
 
-	trsp->command = BCM_WQE_FCP_TRSP64;
-	trsp->class = BCM_ELS_REQUEST64_CLASS_3;
 	trsp->xri_tag = fc_req->xchg->xchg_id;
 	trsp->remote_xid  = fc_req->oxid;
 	trsp->rpi = fc_req->rpi;
-	trsp->len_loc = 0x1;
-	trsp->cq_id = 0xFFFF;
-	trsp->cmd_type = BCM_CMD_FCP_TRSP64_WQE;
-	trsp->nvme = 1;
 
-	rc = nvmf_fc_post_wqe(hwqp, (uint8_t *)trsp, true, nvmf_fc_io_cmpl_cb, fc_req);
+	nvmf_fc_lat_rsp(fc_req);
+	rc = nvmf_fc_wqe_commit(hwqp, (uint8_t *)trsp, true, nvmf_fc_io_cmpl_cb, fc_req);
 	if (!rc) {
 		fc_req->xchg->active = true;
 	}
@@ -3102,7 +4429,7 @@ nvmf_fc_xmt_bls_rsp(struct spdk_nvmf_fc_hwqp *hwqp,
 		goto done;
 	}
 
-	ctx = calloc(1, sizeof(struct spdk_nvmf_fc_caller_ctx));
+	ctx = nvmf_fc_caller_ctx_get(hwqp);
 	if (!ctx) {
 		goto done;
 	}
@@ -3132,7 +4459,7 @@ nvmf_fc_xmt_bls_rsp(struct spdk_nvmf_fc_hwqp *hwqp,
 	rc = nvmf_fc_post_wqe(hwqp, (uint8_t *)bls, true, nvmf_fc_bls_cmpl_cb, ctx);
 done:
 	if (rc && ctx) {
-		free(ctx);
+		nvmf_fc_caller_ctx_put(hwqp, ctx);
 	}
 
 	if (rc && xri) {
@@ -3149,34 +4476,47 @@ done:
 static struct spdk_nvmf_fc_srsr_bufs*
 nvmf_fc_alloc_srsr_bufs(size_t rqst_len, size_t rsp_len)
 {
-	static uint32_t mz_ind = 0;
-	struct nvmf_fc_srsr_bufs *lld_srsr_bufs;
-	struct spdk_nvmf_fc_srsr_bufs *ret_bufs; 
-
-	/* allocate the larger internal structure used to manage srsr buffers */
-	lld_srsr_bufs = calloc(1, sizeof(struct nvmf_fc_srsr_bufs)); 
+	struct nvmf_fc_srsr_bufs *lld_srsr_bufs = NULL;
+	struct spdk_nvmf_fc_srsr_bufs *ret_bufs;
+	uint32_t sgl_len = 2 * sizeof(bcm_sge_t);
 
-	if (!lld_srsr_bufs) {
-		SPDK_ERRLOG("No memory to alloc send disconnect buffer struct\n");
+	if ((rqst_len + rsp_len + sgl_len) > SRSR_SLAB_BUF_SIZE) {
+		SPDK_ERRLOG("SRSR buffer size %zu exceeds %d\n",
+			    rqst_len + rsp_len + sgl_len, SRSR_SLAB_BUF_SIZE);
 		return NULL;
-	} 
+	}
 
-	ret_bufs = &lld_srsr_bufs->srsr_bufs;
-	ret_bufs->rqst_len = rqst_len;
-	ret_bufs->rsp_len = rsp_len;
-	lld_srsr_bufs->sgl_len = 2 * sizeof(bcm_sge_t);
+	if (!g_nvmf_fc_srsr_slab.free_ring ||
+	    spdk_ring_dequeue(g_nvmf_fc_srsr_slab.free_ring, (void **)&lld_srsr_bufs, 1) != 1) {
+		/* Slab exhausted, allocate a standalone slot */
+		SPDK_DEBUGLOG(SPDK_LOG_NVMF_FC_LLD, "SRSR buffer slab empty\n");
 
-	snprintf(lld_srsr_bufs->mz_name, sizeof(lld_srsr_bufs->mz_name), "assoc_dcbuf_%x", mz_ind++);
-	ret_bufs->rqst = spdk_memzone_reserve(lld_srsr_bufs->mz_name, rqst_len + rsp_len +
-					      lld_srsr_bufs->sgl_len, SPDK_ENV_SOCKET_ID_ANY, 0);
+		lld_srsr_bufs = calloc(1, sizeof(struct nvmf_fc_srsr_bufs));
+		if (!lld_srsr_bufs) {
+			SPDK_ERRLOG("No memory to alloc send disconnect buffer struct\n");
+			return NULL;
+		}
 
-	if (ret_bufs->rqst == NULL) {
-		SPDK_ERRLOG("No memory to alloc send disconnect buffer struct\n");
-		free(lld_srsr_bufs);
-		return NULL;
+		lld_srsr_bufs->buf_virt = spdk_dma_zmalloc(SRSR_SLAB_BUF_SIZE, SRSR_SLAB_BUF_SIZE,
+					  &lld_srsr_bufs->buf_phys);
+		if (!lld_srsr_bufs->buf_virt) {
+			SPDK_ERRLOG("No memory to alloc send disconnect buffer\n");
+			free(lld_srsr_bufs);
+			return NULL;
+		}
+		lld_srsr_bufs->from_slab = false;
+	} else {
+		memset(lld_srsr_bufs->buf_virt, 0, SRSR_SLAB_BUF_SIZE);
 	}
 
-	lld_srsr_bufs->rqst_phys = spdk_vtophys(lld_srsr_bufs->srsr_bufs.rqst, NULL);
+	ret_bufs = &lld_srsr_bufs->srsr_bufs;
+	memset(ret_bufs, 0, sizeof(struct spdk_nvmf_fc_srsr_bufs));
+	ret_bufs->rqst_len = rqst_len;
+	ret_bufs->rsp_len = rsp_len;
+	lld_srsr_bufs->sgl_len = sgl_len;
+
+	ret_bufs->rqst = lld_srsr_bufs->buf_virt;
+	lld_srsr_bufs->rqst_phys = lld_srsr_bufs->buf_phys;
 	lld_srsr_bufs->srsr_bufs.rsp = lld_srsr_bufs->srsr_bufs.rqst + ret_bufs->rqst_len;
 	lld_srsr_bufs->rsp_phys = lld_srsr_bufs->rqst_phys + ret_bufs->rqst_len;
 	lld_srsr_bufs->sgl_virt = lld_srsr_bufs->srsr_bufs.rsp + ret_bufs->rsp_len;
@@ -3188,13 +4528,18 @@ nvmf_fc_alloc_srsr_bufs(size_t rqst_len, size_t rsp_len)
 static void
 nvmf_fc_free_srsr_bufs(struct spdk_nvmf_fc_srsr_bufs *srsr_bufs)
 {
-	if (srsr_bufs) {
-		struct nvmf_fc_srsr_bufs *b; 
-		b = SPDK_CONTAINEROF(srsr_bufs, struct nvmf_fc_srsr_bufs, srsr_bufs);
-		if (b) {
-			spdk_memzone_free(b->mz_name);
-		}
-		free(srsr_bufs);
+	struct nvmf_fc_srsr_bufs *b;
+
+	if (!srsr_bufs) {
+		return;
+	}
+
+	b = SPDK_CONTAINEROF(srsr_bufs, struct nvmf_fc_srsr_bufs, srsr_bufs);
+	if (b->from_slab) {
+		spdk_ring_enqueue(g_nvmf_fc_srsr_slab.free_ring, (void **)&b, 1, NULL);
+	} else {
+		spdk_dma_free(b->buf_virt);
+		free(b);
 	}
 }
 
@@ -3229,7 +4574,7 @@ nvmf_fc_xmt_srsr_req(struct spdk_nvmf_fc_hwqp *hwqp,
 		goto done;
 	}
 
-	ctx = calloc(1, sizeof(struct spdk_nvmf_fc_caller_ctx));
+	ctx = nvmf_fc_caller_ctx_get(hwqp);
 	if (!ctx) {
 		goto done;
 	}
@@ -3277,7 +4622,7 @@ nvmf_fc_xmt_srsr_req(struct spdk_nvmf_fc_hwqp *hwqp,
 			      ctx);
 done:
 	if (rc && ctx) {
-		free(ctx);
+		nvmf_fc_caller_ctx_put(hwqp, ctx);
 	}
 
 	if (rc && xri) {
@@ -3328,6 +4673,157 @@ nvmf_fc_gen_conn_id(uint32_t qnum, struct spdk_nvmf_fc_hwqp *hwqp)
 	return ((hwqp->fc_port->num_io_queues * hwq->cid_cnt) + qnum);
 }
 
+/*
+ * Connection placement. The FC layer offers a new connection to the IO
+ * hwqps in turn until one accepts it; with a load based policy only the
+ * hwqp picked at the start of the pass accepts.
+ */
+typedef uint64_t (*nvmf_fc_conn_load_fn)(struct spdk_nvmf_fc_hwqp *hwqp);
+
+struct nvmf_fc_conn_placement {
+	const char *name;
+	nvmf_fc_conn_load_fn load; /* NULL - first fit */
+};
+
+static uint64_t
+nvmf_fc_conn_load_conns(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	return hwqp->num_conns;
+}
+
+static uint64_t
+nvmf_fc_conn_load_io(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	/* Outstanding WQEs, connection count breaks ties */
+	return ((uint64_t)(MAX_REQTAG_POOL_SIZE - BCM_HWQP(hwqp)->wq.reqtag_free_cnt) << 32) |
+	       hwqp->num_conns;
+}
+
+static uint64_t
+nvmf_fc_conn_load_slots(struct spdk_nvmf_fc_hwqp *hwqp)
+{
+	return BCM_HWQP(hwqp)->rq_payload.num_buffers - BCM_HWQP(hwqp)->free_rq_slots;
+}
+
+static const struct nvmf_fc_conn_placement g_nvmf_fc_conn_placements[] = {
+	{ "first_fit",   NULL },
+	{ "least_conns", nvmf_fc_conn_load_conns },
+	{ "least_io",    nvmf_fc_conn_load_io },
+	{ "least_slots", nvmf_fc_conn_load_slots },
+};
+
+static const struct nvmf_fc_conn_placement *g_nvmf_fc_conn_placement;
+
+int
+spdk_nvmf_fc_set_conn_placement(const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(g_nvmf_fc_conn_placements); i++) {
+		if (!strcmp(name, g_nvmf_fc_conn_placements[i].name)) {
+			g_nvmf_fc_conn_placement = &g_nvmf_fc_conn_placements[i];
+			return 0;
+		}
+	}
+
+	SPDK_ERRLOG("Unknown connection placement policy %s\n", name);
+	return -EINVAL;
+}
+
+const char *
+spdk_nvmf_fc_get_conn_placement(void)
+{
+	if (!g_nvmf_fc_conn_placement) {
+		spdk_nvmf_fc_set_conn_placement(BCM_CONN_PLACEMENT_DEFAULT);
+	}
+
+	return g_nvmf_fc_conn_placement->name;
+}
+
+/*
+ * Least loaded online IO hwqp of the port with room for sq_size under the
+ * active policy (lower hwqp_id wins ties), NULL if none has room.
+ */
+static struct spdk_nvmf_fc_hwqp *
+nvmf_fc_conn_placement_pick(struct spdk_nvmf_fc_port *fc_port,
+			    nvmf_fc_conn_load_fn load, uint32_t sq_size)
+{
+	struct spdk_nvmf_fc_hwqp *q, *best = NULL;
+	uint64_t q_load, best_load = 0;
+	uint32_t i;
+
+	for (i = 0; i < fc_port->num_io_queues; i++) {
+		q = &fc_port->io_queues[i];
+		if (q->state != SPDK_FC_HWQP_ONLINE ||
+		    BCM_HWQP(q)->free_rq_slots < sq_size) {
+			continue;
+		}
+
+		q_load = load(q);
+		if (!best || q_load < best_load ||
+		    (q_load == best_load && q->hwqp_id < best->hwqp_id)) {
+			best = q;
+			best_load = q_load;
+		}
+	}
+
+	return best;
+}
+
+/*
+ * One placement pass per connection. The FC layer offers the connection
+ * to the IO hwqps in turn; the first offer snapshots the loads and picks
+ * the target, and only the target accepts. A hwqp offered a second time
+ * means the FC layer started on a new connection. Connections are
+ * assigned one at a time, so a single pass is in flight.
+ */
+static struct {
+	struct spdk_nvmf_fc_port *fc_port; /* NULL - no pass in flight */
+	struct spdk_nvmf_fc_hwqp *target;
+	uint32_t gen;
+	uint32_t offered;
+} g_nvmf_fc_conn_pass;
+
+/*
+ * True if hwqp should take the connection.
+ */
+static bool
+nvmf_fc_conn_placement_accept(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t sq_size)
+{
+	struct spdk_nvmf_fc_port *fc_port = hwqp->fc_port;
+	nvmf_fc_conn_load_fn load;
+	bool room = BCM_HWQP(hwqp)->free_rq_slots >= sq_size;
+
+	spdk_nvmf_fc_get_conn_placement();
+	load = g_nvmf_fc_conn_placement->load;
+	if (!load || !fc_port) {
+		return room;
+	}
+
+	if (g_nvmf_fc_conn_pass.fc_port != fc_port ||
+	    BCM_HWQP(hwqp)->conn_pass == g_nvmf_fc_conn_pass.gen) {
+		g_nvmf_fc_conn_pass.fc_port = fc_port;
+		g_nvmf_fc_conn_pass.target = nvmf_fc_conn_placement_pick(fc_port, load, sq_size);
+		g_nvmf_fc_conn_pass.gen++;
+		g_nvmf_fc_conn_pass.offered = 0;
+	}
+	BCM_HWQP(hwqp)->conn_pass = g_nvmf_fc_conn_pass.gen;
+	g_nvmf_fc_conn_pass.offered++;
+
+	if (!room) {
+		return false;
+	}
+
+	/* Take it if the target was never offered by the end of the pass */
+	if (hwqp == g_nvmf_fc_conn_pass.target || !g_nvmf_fc_conn_pass.target ||
+	    g_nvmf_fc_conn_pass.offered >= fc_port->num_io_queues) {
+		g_nvmf_fc_conn_pass.fc_port = NULL;
+		return true;
+	}
+
+	return false;
+}
+
 static bool
 nvmf_fc_assign_conn_to_hwqp(struct spdk_nvmf_fc_hwqp *hwqp,
 			    uint64_t *conn_id, uint32_t sq_size)
@@ -3336,8 +4832,8 @@ nvmf_fc_assign_conn_to_hwqp(struct spdk_nvmf_fc_hwqp *hwqp,
 
 	SPDK_DEBUGLOG(SPDK_LOG_NVMF_FC_LS, "Assign connection to HWQP\n");
 
-	if (hwq->free_rq_slots < sq_size) {
-		return false; /* no queue has space of this connection */
+	if (!nvmf_fc_conn_placement_accept(hwqp, sq_size)) {
+		return false; /* no space, or the pass picked another hwqp */
 	}
 
 	hwq->free_rq_slots -= sq_size;
@@ -3345,6 +4841,7 @@ nvmf_fc_assign_conn_to_hwqp(struct spdk_nvmf_fc_hwqp *hwqp,
 
 	/* create connection ID */
 	*conn_id = nvmf_fc_gen_conn_id(hwqp->hwqp_id, hwqp);
+	nvmf_fc_conn_counters_add(hwqp, *conn_id);
 
 	SPDK_DEBUGLOG(SPDK_LOG_NVMF_FC_LS,
 		      "QP assign to %d (free %d), conn_id 0x%lx\n",
@@ -3366,6 +4863,7 @@ nvmf_fc_release_conn(struct spdk_nvmf_fc_hwqp *hwqp, uint64_t conn_id,
 { 
 	hwqp->num_conns--;
 	BCM_HWQP(hwqp)->free_rq_slots += sq_size;
+	nvmf_fc_conn_counters_del(hwqp, conn_id);
 }
 
 /*
@@ -3416,12 +4914,7 @@ nvmf_fc_dump_queue_entries(struct spdk_nvmf_fc_queue_dump_info *dump_info,
 	uint8_t *entry = NULL;
 	uint32_t i;
 
-	index = q->tail;
-
-	index -= NVMF_TGT_FC_QDUMP_RADIUS;
-	if (index < 0) {
-		index += q->max_entries;
-	}
+	index = (q->tail - NVMF_TGT_FC_QDUMP_RADIUS) & q->mask;
 
 	/*
 	 * Print the NVMF_TGT_FC_QDUMP_RADIUS number of entries before and
@@ -3433,10 +4926,7 @@ nvmf_fc_dump_queue_entries(struct spdk_nvmf_fc_queue_dump_info *dump_info,
 		entry = q->address;
 		entry += index * q->size;
 		nvmf_fc_dump_buffer(dump_info, name, entry, q->size);
-		index++;
-		if (index >= q->max_entries) {
-			index = 0;
-		}
+		index = (index + 1) & q->mask;
 	}
 	spdk_nvmf_fc_dump_buf_print(dump_info, "\n");
 }
@@ -3466,7 +4956,29 @@ static void
 nvmf_fc_dump_eventq(struct spdk_nvmf_fc_queue_dump_info *dump_info,
 		    char *name, fc_eventq_t *eq)
 {
+	struct fc_q_limit_ctl *ctl = &eq->limit_ctl;
+	struct fc_q_limit_hist *hist;
+	uint32_t i, n;
+
 	nvmf_fc_dump_sli_queue(dump_info, name, &eq->q);
+
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "processed_limit:%" PRIu32 ", posted_limit:%" PRIu32
+				   ", adaptive:%d, adjustments:%" PRIu32 "\n",
+				   eq->q.processed_limit, eq->q.posted_limit,
+				   ctl->enabled, ctl->adjustments);
+
+	/* Oldest to newest */
+	n = spdk_min(ctl->adjustments, BCM_Q_LIMIT_HISTORY);
+	for (i = 0; i < n; i++) {
+		hist = &ctl->history[(ctl->adjustments - n + i) % BCM_Q_LIMIT_HISTORY];
+		spdk_nvmf_fc_dump_buf_print(dump_info,
+					   "  history[%" PRIu32 "]: processed_limit:%" PRIu32
+					   ", posted_limit:%" PRIu32 ", avg_entries:%" PRIu32
+					   ", budget_hits:%" PRIu32 "\n", i,
+					   hist->processed_limit, hist->posted_limit,
+					   hist->avg_entries, hist->budget_hits);
+	}
 }
 
 /*
@@ -3477,6 +4989,10 @@ nvmf_fc_dump_wrkq(struct spdk_nvmf_fc_queue_dump_info *dump_info,
 		  char *name, fc_wrkq_t *wq)
 {
 	nvmf_fc_dump_sli_queue(dump_info, name, &wq->q);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "db_batch:%d, num_pending:%" PRIu32 ", reqtag_free_cnt:%" PRIu32
+				   ", wqec_cnt:%" PRIu32 "\n",
+				   wq->db_batch, wq->num_pending, wq->reqtag_free_cnt, wq->wqec_cnt);
 }
 
 /*
@@ -3486,6 +5002,70 @@ static void
 nvmf_fc_dump_rcvq(struct spdk_nvmf_fc_queue_dump_info *dump_info, char *name, fc_rcvq_t *rq)
 {
 	nvmf_fc_dump_sli_queue(dump_info, name, &rq->q);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "repost_batch:%" PRIu32 ", num_pending:%" PRIu32
+				   ", num_posted:%" PRIu32 "\n",
+				   rq->repost_batch, rq->num_pending, rq->num_posted);
+}
+
+static void
+nvmf_fc_dump_io_counters(struct spdk_nvmf_fc_queue_dump_info *dump_info,
+			 struct fc_io_counters *cnt)
+{
+	uint32_t i;
+
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "cmds_rcvd:%" PRIu64 ", read_ios:%" PRIu64 ", read_bytes:%" PRIu64
+				   ", write_ios:%" PRIu64 ", write_bytes:%" PRIu64 "\n",
+				   cnt->cmds_rcvd, cnt->read_ios, cnt->read_bytes,
+				   cnt->write_ios, cnt->write_bytes);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "wqes_posted:%" PRIu64 ", cqes:%" PRIu64 ", polls:%" PRIu64
+				   ", busy_polls:%" PRIu64 "\n",
+				   cnt->wqes_posted, cnt->cqes, cnt->polls, cnt->busy_polls);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "xri_exhausted:%" PRIu64 ", reqtag_exhausted:%" PRIu64 "\n",
+				   cnt->xri_exhausted, cnt->reqtag_exhausted);
+
+	for (i = 0; i < BCM_MAX_CONN_COUNTERS; i++) {
+		if (cnt->conn[i].conn_id) {
+			spdk_nvmf_fc_dump_buf_print(dump_info,
+						   "  conn 0x%" PRIx64 ": cmds:%" PRIu64 ", read_bytes:%" PRIu64
+						   ", write_bytes:%" PRIu64 "\n",
+						   cnt->conn[i].conn_id, cnt->conn[i].cmds,
+						   cnt->conn[i].read_bytes, cnt->conn[i].write_bytes);
+		}
+	}
+}
+
+static void
+nvmf_fc_dump_lat_stats(struct spdk_nvmf_fc_queue_dump_info *dump_info,
+		       struct fc_lat_stats *lat)
+{
+	struct fc_lat_hist *hist;
+	uint32_t phase, i;
+
+	spdk_nvmf_fc_dump_buf_print(dump_info, "latency (ticks, hz:%" PRIu64 "): %s\n",
+				   spdk_get_ticks_hz(),
+				   g_nvmf_fc_lat_enabled ? "enabled" : "disabled");
+
+	for (phase = 0; phase < BCM_LAT_MAX_PHASE; phase++) {
+		hist = &lat->hist[phase];
+		if (!hist->count) {
+			continue;
+		}
+
+		spdk_nvmf_fc_dump_buf_print(dump_info, "%s: count:%" PRIu64 ", avg:%" PRIu64 "\n",
+					   g_nvmf_fc_lat_phase_names[phase], hist->count,
+					   hist->sum_ticks / hist->count);
+		for (i = 0; i < BCM_LAT_HIST_BUCKETS; i++) {
+			if (hist->bucket[i]) {
+				spdk_nvmf_fc_dump_buf_print(dump_info, "  [%" PRIu64 "]:%" PRIu64 "\n",
+							   spdk_nvmf_fc_lat_bucket_start(i),
+							   hist->bucket[i]);
+			}
+		}
+	}
 }
 
 /*
@@ -3524,6 +5104,64 @@ nvmf_fc_dump_hwqp(struct spdk_nvmf_fc_queue_dump_info *dump_info,
 	 * Dump the RQ-PAYLOAD.
 	 */
 	nvmf_fc_dump_rcvq(dump_info, "rq_payload", &hw_queue->rq_payload);
+
+	/*
+	 * Dump the XRI cache.
+	 */
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "\nxri_cache: count:%" PRIu32 ", low_wm:%" PRIu32 ", high_wm:%" PRIu32
+				   ", reclaims:%" PRIu64,
+				   hw_queue->xri_cache.count, hw_queue->xri_cache.low_wm,
+				   hw_queue->xri_cache.high_wm, hw_queue->xri_cache.reclaims);
+
+	/*
+	 * Dump the LLD statistics.
+	 */
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "\nstats: wq_doorbells:%" PRIu64 ", wq_doorbells_saved:%" PRIu64 "\n",
+				   hw_queue->stats.wq_doorbells,
+				   hw_queue->stats.wq_doorbells_saved);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "rq_doorbells:%" PRIu64 ", rq_doorbells_saved:%" PRIu64 "\n",
+				   hw_queue->stats.rq_doorbells,
+				   hw_queue->stats.rq_doorbells_saved);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "vtophys_hits:%" PRIu64 ", vtophys_misses:%" PRIu64
+				   ", sgl_splits:%" PRIu64 "\n",
+				   hw_queue->stats.vtophys_hits,
+				   hw_queue->stats.vtophys_misses,
+				   hw_queue->stats.sgl_splits);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "wq_releases:%" PRIu64 ", sf_cmpls:%" PRIu64 ", sf_cmpl_err:%" PRIu64 "\n",
+				   hw_queue->stats.wq_releases, hw_queue->stats.sf_cmpls,
+				   hw_queue->stats.sf_cmpl_err);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "caller_ctx_free:%" PRIu32 ", caller_ctx_pool_empty:%" PRIu64
+				   ", marker_args_alloc_err:%" PRIu64 "\n",
+				   hw_queue->ctx_pool.free_cnt,
+				   hw_queue->stats.caller_ctx_pool_empty,
+				   hw_queue->stats.marker_args_alloc_err);
+	spdk_nvmf_fc_dump_buf_print(dump_info,
+				   "rq_frames:%" PRIu64 ", rq_ticks:%" PRIu64 ", ticks/frame:%" PRIu64
+				   ", prefetch_depth:%" PRIu32 "\n",
+				   hw_queue->stats.rq_frames, hw_queue->stats.rq_ticks,
+				   hw_queue->stats.rq_frames ?
+				   hw_queue->stats.rq_ticks / hw_queue->stats.rq_frames : 0,
+				   hw_queue->cq_rq.prefetch_depth);
+
+	/*
+	 * Dump the throughput counters.
+	 */
+	if (hw_queue->io_cnt) {
+		nvmf_fc_dump_io_counters(dump_info, hw_queue->io_cnt);
+	}
+
+	/*
+	 * Dump the latency histograms, non-empty buckets only.
+	 */
+	if (hw_queue->lat) {
+		nvmf_fc_dump_lat_stats(dump_info, hw_queue->lat);
+	}
 }
 
 /*
@@ -3537,6 +5175,9 @@ nvmf_fc_dump_all_queues(struct spdk_nvmf_fc_hwqp *ls_queue,
 {
 	uint32_t i = 0;
 
+	spdk_nvmf_fc_dump_buf_print(dump_info, "\nConnection placement: %s",
+				   spdk_nvmf_fc_get_conn_placement());
+
 	/*
 	 * Dump the LS queue.
 	 */
@@ -3560,7 +5201,12 @@ nvmf_fc_get_xri_info(struct spdk_nvmf_fc_hwqp *hwqp, struct spdk_nvmf_fc_xchg_in
 
 	info->xchg_base = hwq->xri_list->xri_base;
 	info->xchg_total_count = hwq->xri_list->xri_count;
-	info->xchg_avail_count = spdk_ring_count(hwq->xri_list->xri_ring);
+	/*
+	 * XRIs cached by this hwqp are available to it as well. The cache
+	 * occupancy on its own is in the queue dump and the io stats RPC.
+	 */
+	info->xchg_avail_count = spdk_ring_count(hwq->xri_list->xri_ring) +
+				 hwq->xri_cache.count;
 }
 
 static int
@@ -54,27 +54,80 @@ typedef struct bcm_sli_queue {
 	/* the following fields set by the FC driver */
 	uint16_t  qid;           /* f/w Q_ID */
 	uint16_t  size;          /* size of each entry */
-	uint16_t  max_entries;   /* number of entries */
+	uint16_t  max_entries;   /* number of entries (power of 2) */
+	uint16_t  mask;          /* max_entries - 1, for index wrap */
 	void 	  *address;      /* queue address */
 	void 	  *doorbell_reg; /* queue doorbell register address */
 	char	  name[64];      /* unique name */ 
 } bcm_sli_queue_t;
 
+/* Default number of RCQEs to look ahead for prefetching RQ buffers */
+#define BCM_RQ_PREFETCH_DEPTH 4
+
+/*
+ * Adaptive EQ/CQ limits. Every BCM_Q_LIMIT_INTERVAL passes over a queue
+ * the observed entries per pass are checked: if the budget was often
+ * exhausted processed_limit is doubled, if the queue is lightly used it
+ * is halved. posted_limit follows at a quarter of processed_limit.
+ */
+#define BCM_Q_PROCESSED_LIMIT     64
+#define BCM_Q_PROCESSED_LIMIT_MIN 16
+#define BCM_Q_PROCESSED_LIMIT_MAX 512
+#define BCM_Q_POSTED_LIMIT        16
+#define BCM_Q_POSTED_LIMIT_MIN    4
+#define BCM_Q_POSTED_LIMIT_MAX    128
+#define BCM_Q_LIMIT_INTERVAL      1024
+#define BCM_Q_LIMIT_HISTORY       8
+
+struct fc_q_limit_hist {
+	uint32_t processed_limit;
+	uint32_t posted_limit;
+	uint32_t avg_entries;  /* avg entries per pass in the interval */
+	uint32_t budget_hits;  /* passes that exhausted the budget */
+};
+
+struct fc_q_limit_ctl {
+	bool enabled;
+	uint32_t passes;       /* passes in the current interval */
+	uint32_t budget_hits;  /* passes that exhausted processed_limit */
+	uint64_t entries;      /* entries processed in the current interval */
+	uint32_t adjustments;  /* number of completed intervals */
+	struct fc_q_limit_hist history[BCM_Q_LIMIT_HISTORY];
+};
+
 /* EQ/CQ structure */
 typedef struct fc_eventq {
 	bcm_sli_queue_t q;
 	bool auto_arm_flag;     /* set by poller thread only */
+	uint32_t prefetch_depth; /* RCQE lookahead (0 - no prefetch) */
+	struct fc_q_limit_ctl limit_ctl;
 } fc_eventq_t;
 
 /* WQ related */
 typedef void (*bcm_fc_wqe_cb)(void *hwqp, uint8_t *cqe, int32_t status, void *args);
 
-#define MAX_WQ_WQEC_CNT 5
-#define MAX_REQTAG_POOL_SIZE 8191 /* Should be one less than DPDK ring */
+/*
+ * WQEC cadence: every wqec_cnt'th WQE asks for a WQ release CQE. The
+ * default scales with the WQ depth (depth / BCM_WQEC_DEPTH_DIV). Once the
+ * WQ is within two strides of full every WQE asks, so slots are reclaimed
+ * before the ring runs out.
+ */
+#define BCM_WQEC_CNT_MIN   5
+#define BCM_WQEC_CNT_MAX   64
+#define BCM_WQEC_DEPTH_DIV 32
+#define MAX_WQ_DB_BATCH_CNT 64 /* Max WQEs covered by one doorbell (num_posted is 8 bits) */
+#define MAX_REQTAG_POOL_SIZE 8191 /* Number of reqtags per WQ */
+/*
+ * Post send-frame responses on one reqtag reserved per WQ instead of a
+ * reqtag per WQE. The response is completed when posted and its CQE is
+ * dropped on sight; WQ slots are reclaimed through WQEC release.
+ */
+#define BCM_SENDFRAME_SHARED_REQTAG 1
 typedef struct fc_wqe_reqtag {
 	uint16_t index;
 	bcm_fc_wqe_cb cb;
 	void *cb_args;
+	struct fc_wqe_reqtag *next; /* free list link */
 } fc_reqtag_t;
 
 #define MAX_WQ_ENTRIES 4096
@@ -85,29 +138,192 @@ typedef struct fc_wrkq {
 
 	/* internal */
 	uint32_t wqec_count;
-	struct spdk_ring *reqtag_ring;
+	uint32_t wqec_cnt;      /* WQEs per WQEC, see BCM_WQEC_CNT_* */
+	bool db_batch;          /* coalesce WQ doorbells until end of poll */
+	uint32_t num_pending;   /* WQEs written but doorbell not rung yet */
+	/*
+	 * Free reqtags are kept on a LIFO list owned by the hwqp poller
+	 * thread, so no atomics are needed and recently released (cache
+	 * warm) tags are reused first.
+	 */
+	fc_reqtag_t *reqtag_free;
+	uint32_t reqtag_free_cnt;
 	fc_reqtag_t *reqtag_objs;
 	fc_reqtag_t *p_reqtags[MAX_REQTAG_POOL_SIZE];
+	fc_reqtag_t *sf_reqtag; /* shared by send-frame WQEs, NULL - not used */
 } fc_wrkq_t;
 
 #define MAX_RQ_ENTRIES 4096
 /* RQ structure */
+#define MAX_RQ_REPOST_BATCH_CNT 32 /* Max buffers reposted per RQ doorbell */
 typedef struct fc_rcvq {
 	bcm_sli_queue_t q;
 	uint32_t num_buffers;
 	struct spdk_nvmf_fc_buffer_desc *buffer;      /* RQ buffer descriptor array */
 	/* internal */
+	uint32_t repost_batch;  /* reposts coalesced per doorbell (1 - no batching) */
+	uint32_t num_pending;   /* buffers reposted but doorbell not rung yet */
+	uint32_t num_posted;    /* buffers the adapter can see: notified, not yet received */
 	uint32_t rq_map[MAX_RQ_ENTRIES];
 } fc_rcvq_t;
 
+/*
+ * Per-hwqp cache of XRIs in front of the port wide XRI ring.
+ * When the cache runs empty it is refilled with low_wm XRIs in one
+ * ring dequeue; when it reaches high_wm it is drained back to low_wm
+ * in one ring enqueue. high_wm of 0 disables the cache.
+ * An hwqp that finds the port ring empty bumps the port reclaim_gen;
+ * every poller that sees a new generation drains its whole cache back.
+ */
+#define MAX_XRI_CACHE_SIZE 64
+#define XRI_CACHE_LOW_WM   16
+#define XRI_CACHE_HIGH_WM  48
+struct fc_xri_cache {
+	uint32_t count;
+	uint32_t low_wm;
+	uint32_t high_wm;
+	uint32_t reclaim_gen; /* port reclaim generation last acted on */
+	uint64_t reclaims;    /* times the cache was drained for a peer */
+	struct spdk_nvmf_fc_xchg *xri[MAX_XRI_CACHE_SIZE];
+};
+
 struct fc_xri_list {
 	uint32_t xri_base;
 	uint32_t xri_count;
 	struct spdk_nvmf_fc_xchg *xri_list;
 	struct spdk_ring   *xri_ring;
+	uint32_t reclaim_gen; /* bumped when an hwqp finds xri_ring empty */
 	TAILQ_ENTRY(fc_xri_list) link;
 };
 
+/*
+ * Per-hwqp pool of caller contexts for abort, BLS response and SRSR
+ * WQEs, owned by the hwqp poller thread. Contexts are calloc'd only
+ * when the pool is empty.
+ */
+#define MAX_CALLER_CTX_POOL_SIZE 256
+struct fc_caller_ctx_pool {
+	struct spdk_nvmf_fc_caller_ctx *objs;
+	struct spdk_nvmf_fc_caller_ctx *free[MAX_CALLER_CTX_POOL_SIZE];
+	uint32_t free_cnt;
+};
+
+/*
+ * Pre-built FCP WQEs. The fields that are the same for every I/O are
+ * filled in once at queue init; submission copies the template and
+ * patches only the per I/O fields.
+ */
+#define BCM_WQE_TEMPLATE_BYTES 128
+struct fc_wqe_templates {
+	uint8_t tsend[BCM_WQE_TEMPLATE_BYTES];
+	uint8_t trecv[BCM_WQE_TEMPLATE_BYTES];
+	uint8_t trsp[BCM_WQE_TEMPLATE_BYTES];
+};
+
+/*
+ * Per-hwqp direct mapped cache of vtophys translations, keyed by 2MB
+ * virtual page, the granularity SPDK itself translates at. Entries are
+ * only valid while the memory stays registered: the cache is emptied
+ * when gen no longer matches the generation the LLD bumps on every
+ * spdk_mem_unregister().
+ */
+#define VTOPHYS_CACHE_SIZE 64 /* must be a power of 2 */
+#define VTOPHYS_PAGE_SHIFT 21
+#define VTOPHYS_PAGE_SIZE  (1ULL << VTOPHYS_PAGE_SHIFT)
+#define VTOPHYS_PAGE_MASK  (VTOPHYS_PAGE_SIZE - 1)
+struct fc_vtophys_cache {
+	uint32_t gen;   /* unregister generation the entries were filled in */
+	struct {
+		uint64_t vpage; /* virtual address >> VTOPHYS_PAGE_SHIFT, 0 - empty */
+		uint64_t phys;  /* physical address of the page */
+	} entry[VTOPHYS_CACHE_SIZE];
+};
+
+/* LLD statistics for each hwqp (updated by poller thread only) */
+struct bcm_nvmf_hwqp_stats {
+	uint64_t wq_doorbells;       /* WQ doorbells rung */
+	uint64_t wq_doorbells_saved; /* WQ doorbells avoided by batching */
+	uint64_t rq_doorbells;       /* RQ doorbells rung for buffer reposts */
+	uint64_t rq_doorbells_saved; /* RQ doorbells avoided by batching */
+	uint64_t vtophys_hits;       /* translations served by vtophys_cache */
+	uint64_t vtophys_misses;     /* translations that called spdk_vtophys */
+	uint64_t sgl_splits;         /* extra SGEs for physically split buffers */
+	uint64_t caller_ctx_pool_empty; /* caller contexts calloc'd, pool empty */
+	uint64_t marker_args_alloc_err; /* marker CQEs dropped, no poller args */
+	uint64_t rq_frames;          /* frames received on the RQ CQ */
+	uint64_t rq_ticks;           /* ticks spent processing RQ CQ frames */
+	uint64_t wq_releases;        /* WQ release CQEs */
+	uint64_t sf_cmpls;           /* send-frame CQEs dropped on the shared reqtag */
+	uint64_t sf_cmpl_err;        /* ... of which reported an error */
+};
+
+/*
+ * Per-hwqp I/O latency histograms, one per FC exchange phase:
+ *  rx_to_wqe - command frame received to first TSEND/TRECEIVE/TRSP posted
+ *  data      - first data WQE posted to response posted (or completed,
+ *              for auto-response). Includes the backend for writes.
+ *  rsp       - response posted to exchange completed
+ *  total     - command frame received to exchange completed
+ * Buckets are log-linear in ticks: BCM_LAT_HIST_SUB_BITS bits of
+ * resolution below each power of 2. Timestamps are kept per RQ buffer,
+ * which identifies the command for the life of the exchange.
+ */
+enum bcm_lat_phase {
+	BCM_LAT_RX_TO_WQE = 0,
+	BCM_LAT_DATA,
+	BCM_LAT_RSP,
+	BCM_LAT_TOTAL,
+	BCM_LAT_MAX_PHASE,
+};
+
+#define BCM_LAT_HIST_SUB_BITS 2
+#define BCM_LAT_HIST_BUCKETS  (64 << BCM_LAT_HIST_SUB_BITS)
+struct fc_lat_hist {
+	uint64_t count;
+	uint64_t sum_ticks;
+	uint64_t bucket[BCM_LAT_HIST_BUCKETS];
+};
+
+struct fc_io_ts {
+	uint64_t rx;   /* command received, 0 - not tracked */
+	uint64_t data; /* first data WQE posted */
+	uint64_t rsp;  /* response posted */
+};
+
+struct fc_lat_stats {
+	struct fc_lat_hist hist[BCM_LAT_MAX_PHASE];
+	struct fc_io_ts ts[MAX_RQ_ENTRIES];
+};
+
+/*
+ * Per-hwqp throughput counters, with rollups for the connections placed
+ * on the hwqp. Allocated on its own cache line boundary so the owning
+ * poller never shares lines with neighbouring hwqps' queue state.
+ */
+#define BCM_MAX_CONN_COUNTERS 256 /* must be a power of 2 */
+struct fc_conn_counters {
+	uint64_t conn_id; /* 0 - free slot */
+	uint64_t cmds;
+	uint64_t read_bytes;
+	uint64_t write_bytes;
+};
+
+struct fc_io_counters {
+	uint64_t start_ticks;      /* when counting started */
+	uint64_t cmds_rcvd;        /* frames handed to the NVMf layer */
+	uint64_t read_ios;
+	uint64_t read_bytes;
+	uint64_t write_ios;
+	uint64_t write_bytes;
+	uint64_t wqes_posted;
+	uint64_t cqes;             /* CQEs processed on both CQs */
+	uint64_t polls;
+	uint64_t busy_polls;       /* polls that found EQEs */
+	uint64_t xri_exhausted;    /* nvmf_fc_get_xri() found none */
+	uint64_t reqtag_exhausted; /* WQE dropped, no reqtag */
+	struct fc_conn_counters conn[BCM_MAX_CONN_COUNTERS];
+};
+
 /*
  * Hardware queues structure.
  * Structure passed from master thread to poller thread.
@@ -120,14 +336,69 @@ struct bcm_nvmf_hw_queues {
 	struct fc_rcvq rq_hdr;
 	struct fc_rcvq rq_payload;
 	struct fc_xri_list *xri_list;
+	struct fc_xri_cache xri_cache;
+	struct fc_caller_ctx_pool ctx_pool;
 	uint32_t free_rq_slots;
 	uint16_t cid_cnt;   /* used to generate unique connection id for MRQ */
+	uint32_t conn_pass; /* placement pass that last offered a connection */
 	TAILQ_HEAD(, spdk_nvmf_fc_xchg) pending_xri_list;
 	uint32_t send_frame_xri;
 	uint8_t send_frame_seqid;
+	struct fc_wqe_templates wqe_tmpl;
+	struct fc_vtophys_cache vtophys_cache;
+	struct bcm_nvmf_hwqp_stats stats;
+	struct fc_lat_stats *lat;
+	struct fc_io_counters *io_cnt;
 };
 
 /* functions to manage XRI's (for each port) */
 struct fc_xri_list* spdk_nvmf_fc_create_xri_list(uint32_t xri_base, uint32_t xri_count);
 
+/*
+ * Connection placement policies for IO hwqps:
+ *  "first_fit"   - first hwqp with enough free RQ slots
+ *  "least_conns" - hwqp with the fewest connections
+ *  "least_io"    - hwqp with the fewest outstanding WQEs, then connections
+ *  "least_slots" - hwqp with the fewest RQ slots reserved by connections
+ * Load based policies pick the target once per connection, when the
+ * first hwqp is offered.
+ */
+#define BCM_CONN_PLACEMENT_DEFAULT "first_fit"
+int spdk_nvmf_fc_set_conn_placement(const char *name);
+const char *spdk_nvmf_fc_get_conn_placement(void);
+
+/*
+ * Per-hwqp tunables. The check functions only validate a value; the set
+ * functions validate it and apply it on the hwqp poller thread.
+ */
+
+/* WQEC cadence of an hwqp, 0 - scale with the WQ depth */
+int spdk_nvmf_fc_check_wqec_cnt(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t wqec_cnt);
+int spdk_nvmf_fc_set_wqec_cnt(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t wqec_cnt);
+
+/* RCQE prefetch lookahead of an hwqp, 0 disables prefetch */
+int spdk_nvmf_fc_check_rq_prefetch_depth(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t depth);
+int spdk_nvmf_fc_set_rq_prefetch_depth(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t depth);
+
+/* XRI cache watermarks of an hwqp, high_wm of 0 disables the cache */
+int spdk_nvmf_fc_check_xri_cache_wm(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t low_wm,
+				    uint32_t high_wm);
+int spdk_nvmf_fc_set_xri_cache_wm(struct spdk_nvmf_fc_hwqp *hwqp, uint32_t low_wm,
+				  uint32_t high_wm);
+
+/* I/O latency histograms, off by default */
+void spdk_nvmf_fc_lat_hist_enable(bool enable);
+bool spdk_nvmf_fc_lat_hist_enabled(void);
+const char *spdk_nvmf_fc_lat_phase_name(uint32_t phase);
+uint64_t spdk_nvmf_fc_lat_bucket_start(uint32_t bucket);
+
+/* hwqps set up by this driver, for the RPCs */
+#define BCM_MAX_HWQPS 128
+uint32_t spdk_nvmf_fc_get_hwqp_count(void);
+struct spdk_nvmf_fc_hwqp *spdk_nvmf_fc_get_hwqp(uint32_t index);
+uint8_t spdk_nvmf_fc_get_hwqp_port(uint32_t index);
+
+/* Release the queue resources set up by init_q, before the queues are freed */
+void spdk_nvmf_fc_fini_q(struct bcm_nvmf_hw_queues *hwq);
+
 #endif
@@ -0,0 +1,524 @@
+/*
+ *   BSD LICENSE
+ *
+ *   Copyright (c) 2018 Broadcom.  All Rights Reserved.
+ *   The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/env.h"
+#include "spdk_internal/log.h"
+#include "spdk_nvmf_xport.h"
+
+/*
+ * JSON-RPC methods for the Broadcom FC NVMf LLD statistics.
+ */
+
+struct rpc_nvmf_fc_lat_hist {
+	bool enable;
+};
+
+static const struct spdk_json_object_decoder rpc_nvmf_fc_lat_hist_decoders[] = {
+	{"enable", offsetof(struct rpc_nvmf_fc_lat_hist, enable), spdk_json_decode_bool},
+};
+
+static void
+spdk_rpc_set_nvmf_fc_lat_hist(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_fc_lat_hist req = {};
+	struct spdk_json_write_ctx *w;
+
+	if (spdk_json_decode_object(params, rpc_nvmf_fc_lat_hist_decoders,
+				    SPDK_COUNTOF(rpc_nvmf_fc_lat_hist_decoders), &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		return;
+	}
+
+	spdk_nvmf_fc_lat_hist_enable(req.enable);
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		return;
+	}
+
+	spdk_json_write_bool(w, true);
+	spdk_jsonrpc_end_result(request, w);
+}
+SPDK_RPC_REGISTER("set_nvmf_fc_lat_hist", spdk_rpc_set_nvmf_fc_lat_hist, SPDK_RPC_RUNTIME)
+
+static void
+rpc_dump_nvmf_fc_lat_hist(struct spdk_json_write_ctx *w, struct fc_lat_hist *hist)
+{
+	uint32_t i;
+
+	spdk_json_write_named_uint64(w, "count", hist->count);
+	spdk_json_write_named_uint64(w, "sum_ticks", hist->sum_ticks);
+
+	spdk_json_write_named_array_begin(w, "buckets");
+	for (i = 0; i < BCM_LAT_HIST_BUCKETS; i++) {
+		if (!hist->bucket[i]) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint64(w, "start_ticks", spdk_nvmf_fc_lat_bucket_start(i));
+		spdk_json_write_named_uint64(w, "count", hist->bucket[i]);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+}
+
+static void
+spdk_rpc_get_nvmf_fc_lat_hist(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct spdk_json_write_ctx *w;
+	struct spdk_nvmf_fc_hwqp *hwqp;
+	struct fc_lat_stats *lat;
+	uint32_t i, phase;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "get_nvmf_fc_lat_hist requires no parameters");
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_bool(w, "enabled", spdk_nvmf_fc_lat_hist_enabled());
+	spdk_json_write_named_uint64(w, "tick_rate", spdk_get_ticks_hz());
+
+	spdk_json_write_named_array_begin(w, "hwqps");
+	for (i = 0; i < spdk_nvmf_fc_get_hwqp_count(); i++) {
+		hwqp = spdk_nvmf_fc_get_hwqp(i);
+		lat = ((struct bcm_nvmf_hw_queues *)hwqp->queues)->lat;
+		if (!lat) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint32(w, "port", spdk_nvmf_fc_get_hwqp_port(i));
+		spdk_json_write_named_uint32(w, "hwqp_id", hwqp->hwqp_id);
+		for (phase = 0; phase < BCM_LAT_MAX_PHASE; phase++) {
+			spdk_json_write_named_object_begin(w, spdk_nvmf_fc_lat_phase_name(phase));
+			rpc_dump_nvmf_fc_lat_hist(w, &lat->hist[phase]);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+SPDK_RPC_REGISTER("get_nvmf_fc_lat_hist", spdk_rpc_get_nvmf_fc_lat_hist, SPDK_RPC_RUNTIME)
+
+/*
+ * Counter values at the previous get_nvmf_fc_io_stats call, per registered
+ * hwqp, so rates cover the interval between calls. The first call reports
+ * rates since the counters were allocated; so does the first call after a
+ * registry slot is taken over by other counters.
+ */
+struct rpc_nvmf_fc_io_snap {
+	const struct fc_io_counters *cnt;
+	uint64_t ticks;
+	uint64_t cmds_rcvd;
+	uint64_t read_bytes;
+	uint64_t write_bytes;
+	uint64_t wqes_posted;
+};
+
+static struct rpc_nvmf_fc_io_snap g_rpc_nvmf_fc_io_snap[BCM_MAX_HWQPS];
+
+static uint64_t
+rpc_nvmf_fc_rate(uint64_t delta, uint64_t ticks, uint64_t hz)
+{
+	/* Split to keep delta * hz from overflowing */
+	return ticks ? (delta / ticks) * hz + ((delta % ticks) * hz) / ticks : 0;
+}
+
+static void
+rpc_dump_nvmf_fc_io_counters(struct spdk_json_write_ctx *w,
+			     struct spdk_nvmf_fc_hwqp *hwqp, uint8_t port_hdl,
+			     struct rpc_nvmf_fc_io_snap *snap)
+{
+	struct bcm_nvmf_hw_queues *hwq = (struct bcm_nvmf_hw_queues *)hwqp->queues;
+	struct fc_io_counters *cnt = hwq->io_cnt;
+	uint64_t now = spdk_get_ticks();
+	uint64_t hz = spdk_get_ticks_hz();
+	uint64_t interval;
+	uint32_t i;
+
+	if (snap->cnt != cnt) {
+		memset(snap, 0, sizeof(*snap));
+		snap->cnt = cnt;
+		snap->ticks = cnt->start_ticks;
+	}
+	interval = now - snap->ticks;
+
+	spdk_json_write_named_uint32(w, "port", port_hdl);
+	spdk_json_write_named_uint32(w, "hwqp_id", hwqp->hwqp_id);
+	spdk_json_write_named_uint32(w, "num_conns", hwqp->num_conns);
+	spdk_json_write_named_uint64(w, "cmds_rcvd", cnt->cmds_rcvd);
+	spdk_json_write_named_uint64(w, "read_ios", cnt->read_ios);
+	spdk_json_write_named_uint64(w, "read_bytes", cnt->read_bytes);
+	spdk_json_write_named_uint64(w, "write_ios", cnt->write_ios);
+	spdk_json_write_named_uint64(w, "write_bytes", cnt->write_bytes);
+	spdk_json_write_named_uint64(w, "wqes_posted", cnt->wqes_posted);
+	spdk_json_write_named_uint64(w, "wq_doorbells", hwq->stats.wq_doorbells);
+	spdk_json_write_named_uint64(w, "rq_doorbells", hwq->stats.rq_doorbells);
+	spdk_json_write_named_uint64(w, "cqes", cnt->cqes);
+	spdk_json_write_named_uint64(w, "polls", cnt->polls);
+	spdk_json_write_named_uint64(w, "busy_polls", cnt->busy_polls);
+	spdk_json_write_named_uint64(w, "cqes_per_busy_poll",
+				     cnt->busy_polls ? cnt->cqes / cnt->busy_polls : 0);
+	spdk_json_write_named_uint64(w, "xri_exhausted", cnt->xri_exhausted);
+	spdk_json_write_named_uint32(w, "xri_cache_count", hwq->xri_cache.count);
+	spdk_json_write_named_uint32(w, "xri_cache_low_wm", hwq->xri_cache.low_wm);
+	spdk_json_write_named_uint32(w, "xri_cache_high_wm", hwq->xri_cache.high_wm);
+	spdk_json_write_named_uint64(w, "xri_cache_reclaims", hwq->xri_cache.reclaims);
+	spdk_json_write_named_uint64(w, "reqtag_exhausted", cnt->reqtag_exhausted);
+
+	spdk_json_write_named_uint64(w, "interval_ticks", interval);
+	spdk_json_write_named_uint64(w, "cmds_per_sec",
+				     rpc_nvmf_fc_rate(cnt->cmds_rcvd - snap->cmds_rcvd, interval, hz));
+	spdk_json_write_named_uint64(w, "read_bytes_per_sec",
+				     rpc_nvmf_fc_rate(cnt->read_bytes - snap->read_bytes, interval, hz));
+	spdk_json_write_named_uint64(w, "write_bytes_per_sec",
+				     rpc_nvmf_fc_rate(cnt->write_bytes - snap->write_bytes, interval, hz));
+	spdk_json_write_named_uint64(w, "wqes_per_sec",
+				     rpc_nvmf_fc_rate(cnt->wqes_posted - snap->wqes_posted, interval, hz));
+
+	snap->ticks = now;
+	snap->cmds_rcvd = cnt->cmds_rcvd;
+	snap->read_bytes = cnt->read_bytes;
+	snap->write_bytes = cnt->write_bytes;
+	snap->wqes_posted = cnt->wqes_posted;
+
+	spdk_json_write_named_array_begin(w, "connections");
+	for (i = 0; i < BCM_MAX_CONN_COUNTERS; i++) {
+		if (!cnt->conn[i].conn_id) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint64(w, "conn_id", cnt->conn[i].conn_id);
+		spdk_json_write_named_uint64(w, "cmds", cnt->conn[i].cmds);
+		spdk_json_write_named_uint64(w, "read_bytes", cnt->conn[i].read_bytes);
+		spdk_json_write_named_uint64(w, "write_bytes", cnt->conn[i].write_bytes);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+}
+
+static void
+spdk_rpc_get_nvmf_fc_io_stats(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct spdk_json_write_ctx *w;
+	struct spdk_nvmf_fc_hwqp *hwqp;
+	uint32_t i;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "get_nvmf_fc_io_stats requires no parameters");
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		return;
+	}
+
+	spdk_json_write_array_begin(w);
+	for (i = 0; i < spdk_nvmf_fc_get_hwqp_count(); i++) {
+		hwqp = spdk_nvmf_fc_get_hwqp(i);
+		if (!((struct bcm_nvmf_hw_queues *)hwqp->queues)->io_cnt) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		rpc_dump_nvmf_fc_io_counters(w, hwqp, spdk_nvmf_fc_get_hwqp_port(i),
+					     &g_rpc_nvmf_fc_io_snap[i]);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+
+	spdk_jsonrpc_end_result(request, w);
+}
+SPDK_RPC_REGISTER("get_nvmf_fc_io_stats", spdk_rpc_get_nvmf_fc_io_stats, SPDK_RPC_RUNTIME)
+
+/*
+ * hwqps a set_nvmf_fc_* RPC applies to: those with the given port and ID,
+ * UINT32_MAX (the default when not given) matching any.
+ */
+struct rpc_nvmf_fc_hwqp_sel {
+	uint32_t port;
+	uint32_t hwqp_id;
+};
+
+#define RPC_NVMF_FC_HWQP_SEL_DECODERS(type) \
+	{"port", offsetof(type, sel.port), spdk_json_decode_uint32, true}, \
+	{"hwqp_id", offsetof(type, sel.hwqp_id), spdk_json_decode_uint32, true}
+
+#define RPC_NVMF_FC_HWQP_SEL_ANY { .port = UINT32_MAX, .hwqp_id = UINT32_MAX }
+
+/* Validates (apply false) or sets (apply true) the request value on an hwqp */
+typedef int (*rpc_nvmf_fc_hwqp_set_fn)(struct spdk_nvmf_fc_hwqp *hwqp, void *req, bool apply);
+
+static bool
+rpc_nvmf_fc_hwqp_selected(const struct rpc_nvmf_fc_hwqp_sel *sel, uint32_t index)
+{
+	struct spdk_nvmf_fc_hwqp *hwqp = spdk_nvmf_fc_get_hwqp(index);
+
+	return (sel->port == UINT32_MAX || spdk_nvmf_fc_get_hwqp_port(index) == sel->port) &&
+	       (sel->hwqp_id == UINT32_MAX || hwqp->hwqp_id == sel->hwqp_id);
+}
+
+/*
+ * Validate the request against every hwqp matching sel, then set it on all
+ * of them, and complete the request. Nothing is changed if any hwqp rejects
+ * the value; that is reported with err_msg.
+ */
+static void
+rpc_nvmf_fc_set_hwqps(struct spdk_jsonrpc_request *request,
+		      const struct rpc_nvmf_fc_hwqp_sel *sel,
+		      rpc_nvmf_fc_hwqp_set_fn set_fn, void *req, const char *err_msg)
+{
+	struct spdk_json_write_ctx *w;
+	uint32_t i;
+
+	for (i = 0; i < spdk_nvmf_fc_get_hwqp_count(); i++) {
+		if (rpc_nvmf_fc_hwqp_selected(sel, i) &&
+		    set_fn(spdk_nvmf_fc_get_hwqp(i), req, false)) {
+			spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							 err_msg);
+			return;
+		}
+	}
+
+	for (i = 0; i < spdk_nvmf_fc_get_hwqp_count(); i++) {
+		if (rpc_nvmf_fc_hwqp_selected(sel, i) &&
+		    set_fn(spdk_nvmf_fc_get_hwqp(i), req, true)) {
+			spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+							 "Failed to apply the setting to all hwqps");
+			return;
+		}
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		return;
+	}
+
+	spdk_json_write_bool(w, true);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+struct rpc_nvmf_fc_wqec_cnt {
+	struct rpc_nvmf_fc_hwqp_sel sel;
+	uint32_t wqec_cnt;
+};
+
+static const struct spdk_json_object_decoder rpc_nvmf_fc_wqec_cnt_decoders[] = {
+	RPC_NVMF_FC_HWQP_SEL_DECODERS(struct rpc_nvmf_fc_wqec_cnt),
+	{"wqec_cnt", offsetof(struct rpc_nvmf_fc_wqec_cnt, wqec_cnt), spdk_json_decode_uint32},
+};
+
+static int
+rpc_nvmf_fc_set_wqec_cnt(struct spdk_nvmf_fc_hwqp *hwqp, void *arg, bool apply)
+{
+	struct rpc_nvmf_fc_wqec_cnt *req = arg;
+
+	return apply ? spdk_nvmf_fc_set_wqec_cnt(hwqp, req->wqec_cnt) :
+	       spdk_nvmf_fc_check_wqec_cnt(hwqp, req->wqec_cnt);
+}
+
+/*
+ * Set the WQEC cadence of the selected hwqps. A wqec_cnt of 0 restores the
+ * default for the WQ depth.
+ */
+static void
+spdk_rpc_set_nvmf_fc_wqec_cnt(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_fc_wqec_cnt req = { .sel = RPC_NVMF_FC_HWQP_SEL_ANY };
+
+	if (spdk_json_decode_object(params, rpc_nvmf_fc_wqec_cnt_decoders,
+				    SPDK_COUNTOF(rpc_nvmf_fc_wqec_cnt_decoders), &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		return;
+	}
+
+	rpc_nvmf_fc_set_hwqps(request, &req.sel, rpc_nvmf_fc_set_wqec_cnt, &req,
+			      "wqec_cnt too large for the WQ depth");
+}
+SPDK_RPC_REGISTER("set_nvmf_fc_wqec_cnt", spdk_rpc_set_nvmf_fc_wqec_cnt, SPDK_RPC_RUNTIME)
+
+struct rpc_nvmf_fc_rq_prefetch_depth {
+	struct rpc_nvmf_fc_hwqp_sel sel;
+	uint32_t prefetch_depth;
+};
+
+static const struct spdk_json_object_decoder rpc_nvmf_fc_rq_prefetch_depth_decoders[] = {
+	RPC_NVMF_FC_HWQP_SEL_DECODERS(struct rpc_nvmf_fc_rq_prefetch_depth),
+	{"prefetch_depth", offsetof(struct rpc_nvmf_fc_rq_prefetch_depth, prefetch_depth), spdk_json_decode_uint32},
+};
+
+static int
+rpc_nvmf_fc_set_rq_prefetch_depth(struct spdk_nvmf_fc_hwqp *hwqp, void *arg, bool apply)
+{
+	struct rpc_nvmf_fc_rq_prefetch_depth *req = arg;
+
+	return apply ? spdk_nvmf_fc_set_rq_prefetch_depth(hwqp, req->prefetch_depth) :
+	       spdk_nvmf_fc_check_rq_prefetch_depth(hwqp, req->prefetch_depth);
+}
+
+/*
+ * Set the RCQE prefetch lookahead of the selected hwqps. A prefetch_depth
+ * of 0 disables prefetch.
+ */
+static void
+spdk_rpc_set_nvmf_fc_rq_prefetch_depth(struct spdk_jsonrpc_request *request,
+				       const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_fc_rq_prefetch_depth req = { .sel = RPC_NVMF_FC_HWQP_SEL_ANY };
+
+	if (spdk_json_decode_object(params, rpc_nvmf_fc_rq_prefetch_depth_decoders,
+				    SPDK_COUNTOF(rpc_nvmf_fc_rq_prefetch_depth_decoders), &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		return;
+	}
+
+	rpc_nvmf_fc_set_hwqps(request, &req.sel, rpc_nvmf_fc_set_rq_prefetch_depth, &req,
+			      "prefetch_depth too large for the CQ depth");
+}
+SPDK_RPC_REGISTER("set_nvmf_fc_rq_prefetch_depth", spdk_rpc_set_nvmf_fc_rq_prefetch_depth,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_nvmf_fc_xri_cache_wm {
+	struct rpc_nvmf_fc_hwqp_sel sel;
+	uint32_t low_wm;
+	uint32_t high_wm;
+};
+
+static const struct spdk_json_object_decoder rpc_nvmf_fc_xri_cache_wm_decoders[] = {
+	RPC_NVMF_FC_HWQP_SEL_DECODERS(struct rpc_nvmf_fc_xri_cache_wm),
+	{"low_wm", offsetof(struct rpc_nvmf_fc_xri_cache_wm, low_wm), spdk_json_decode_uint32},
+	{"high_wm", offsetof(struct rpc_nvmf_fc_xri_cache_wm, high_wm), spdk_json_decode_uint32},
+};
+
+static int
+rpc_nvmf_fc_set_xri_cache_wm(struct spdk_nvmf_fc_hwqp *hwqp, void *arg, bool apply)
+{
+	struct rpc_nvmf_fc_xri_cache_wm *req = arg;
+
+	return apply ? spdk_nvmf_fc_set_xri_cache_wm(hwqp, req->low_wm, req->high_wm) :
+	       spdk_nvmf_fc_check_xri_cache_wm(hwqp, req->low_wm, req->high_wm);
+}
+
+/*
+ * Set the XRI cache watermarks of the selected hwqps. A high_wm of 0
+ * disables the cache.
+ */
+static void
+spdk_rpc_set_nvmf_fc_xri_cache_wm(struct spdk_jsonrpc_request *request,
+				  const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_fc_xri_cache_wm req = { .sel = RPC_NVMF_FC_HWQP_SEL_ANY };
+
+	if (spdk_json_decode_object(params, rpc_nvmf_fc_xri_cache_wm_decoders,
+				    SPDK_COUNTOF(rpc_nvmf_fc_xri_cache_wm_decoders), &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		return;
+	}
+
+	rpc_nvmf_fc_set_hwqps(request, &req.sel, rpc_nvmf_fc_set_xri_cache_wm, &req,
+			      "Invalid XRI cache watermarks");
+}
+SPDK_RPC_REGISTER("set_nvmf_fc_xri_cache_wm", spdk_rpc_set_nvmf_fc_xri_cache_wm, SPDK_RPC_RUNTIME)
+
+struct rpc_nvmf_fc_conn_placement {
+	char *policy;
+};
+
+static const struct spdk_json_object_decoder rpc_nvmf_fc_conn_placement_decoders[] = {
+	{"policy", offsetof(struct rpc_nvmf_fc_conn_placement, policy), spdk_json_decode_string},
+};
+
+/*
+ * Select the connection placement policy for new connections
+ * ("first_fit", "least_conns", "least_io" or "least_slots").
+ */
+static void
+spdk_rpc_set_nvmf_fc_conn_placement(struct spdk_jsonrpc_request *request,
+				    const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_fc_conn_placement req = {};
+	struct spdk_json_write_ctx *w;
+
+	if (spdk_json_decode_object(params, rpc_nvmf_fc_conn_placement_decoders,
+				    SPDK_COUNTOF(rpc_nvmf_fc_conn_placement_decoders), &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto out;
+	}
+
+	if (spdk_nvmf_fc_set_conn_placement(req.policy)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Unknown connection placement policy");
+		goto out;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		goto out;
+	}
+
+	spdk_json_write_string(w, spdk_nvmf_fc_get_conn_placement());
+	spdk_jsonrpc_end_result(request, w);
+out:
+	free(req.policy);
+}
+SPDK_RPC_REGISTER("set_nvmf_fc_conn_placement", spdk_rpc_set_nvmf_fc_conn_placement, SPDK_RPC_RUNTIME)